@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace mrn {
+
+// LSB 优先的位写入器，使用 64 位累加器按整字节批量刷出。
+// 目标缓冲区末尾必须预留至少 8 字节的余量（flush 会整体写入 8 字节）。
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : begin_(out), out_(out) {}
+
+    // 追加 count 位；两次 flush 之间累计写入不得超过 56 位
+    void write(uint64_t bits, unsigned count) {
+        acc_ |= bits << filled_;
+        filled_ += count;
+    }
+
+    // 将累加器中的完整字节写出，剩余不足 8 位保留
+    void flush() {
+        std::memcpy(out_, &acc_, sizeof(acc_));
+        out_ += filled_ >> 3;
+        acc_ >>= filled_ & ~7u;
+        filled_ &= 7;
+    }
+
+    // 刷出所有位（末字节高位补零），返回写入的总字节数
+    size_t finish() {
+        flush();
+        if (filled_ > 0) {
+            *out_++ = static_cast<uint8_t>(acc_);
+            acc_ = 0;
+            filled_ = 0;
+        }
+        return static_cast<size_t>(out_ - begin_);
+    }
+
+private:
+    uint8_t* begin_;
+    uint8_t* out_;
+    uint64_t acc_ = 0;
+    unsigned filled_ = 0;
+};
+
+// LSB 优先的位读取器。读越界时补零位，调用方依据符号计数判断结束。
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    // 保证累加器中至少有 56 位可用（输入耗尽时以零补齐）
+    void refill() {
+        if (pos_ + 8 <= size_) {
+            uint64_t word;
+            std::memcpy(&word, data_ + pos_, sizeof(word));
+            acc_ |= word << avail_;
+            pos_ += (63 - avail_) >> 3;
+            avail_ |= 56;
+            return;
+        }
+        while (avail_ <= 56) {
+            if (pos_ < size_) {
+                acc_ |= static_cast<uint64_t>(data_[pos_]) << avail_;
+            }
+            ++pos_;
+            avail_ += 8;
+        }
+    }
+
+    uint64_t peek(unsigned count) const {
+        return acc_ & ((uint64_t(1) << count) - 1);
+    }
+
+    void consume(unsigned count) {
+        acc_ >>= count;
+        avail_ -= count;
+    }
+
+    uint64_t read(unsigned count) {
+        const uint64_t value = peek(count);
+        consume(count);
+        return value;
+    }
+
+    // 已消耗的位数是否超出了输入长度（用于检测截断的码流）
+    bool overrun() const {
+        return pos_ * 8 > size_ * 8 + avail_;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;
+    unsigned avail_ = 0;
+};
+
+// 逆向位读取器：按与 BitWriter 写入相反的顺序读出位（后写先读），供 ANS 解码使用。
+// 码流末尾必须有一个值为 1 的终止标记位，用于定位最后一个有效位。
+class BackwardBitReader {
+public:
+    BackwardBitReader(const uint8_t* data, size_t size) : data_(data) {
+        if (size == 0 || data[size - 1] == 0) {
+            throw std::runtime_error("BackwardBitReader: missing end marker");
+        }
+        const unsigned markerBit = 31 - static_cast<unsigned>(__builtin_clz(data[size - 1]));
+        if (size >= sizeof(uint64_t)) {
+            pos_ = size - sizeof(uint64_t);
+            std::memcpy(&acc_, data_ + pos_, sizeof(acc_));
+            consumed_ = 8 - markerBit;
+        } else {
+            pos_ = 0;
+            for (size_t i = 0; i < size; ++i) {
+                acc_ |= static_cast<uint64_t>(data[i]) << (i * 8);
+            }
+            consumed_ = static_cast<unsigned>(sizeof(uint64_t) - size) * 8 + 8 - markerBit;
+        }
+    }
+
+    // 读取最近写入的 count 位（1 <= count <= 56，且两次 reload 之间累计不超过 56 位）
+    uint64_t read(unsigned count) {
+        const uint64_t value = ((acc_ << (consumed_ & 63)) >> 1) >> ((63 - count) & 63);
+        consumed_ += count;
+        return value;
+    }
+
+    void reload() {
+        if (consumed_ > 64) {
+            return;
+        }
+        if (pos_ >= sizeof(uint64_t)) {
+            pos_ -= consumed_ >> 3;
+            consumed_ &= 7;
+        } else if (pos_ > 0) {
+            size_t bytes = consumed_ >> 3;
+            if (bytes > pos_) {
+                bytes = pos_;
+            }
+            pos_ -= bytes;
+            consumed_ -= static_cast<unsigned>(bytes * 8);
+        } else {
+            return;
+        }
+        std::memcpy(&acc_, data_ + pos_, sizeof(acc_));
+    }
+
+    // 是否恰好读完全部有效位
+    bool finished() const {
+        return pos_ == 0 && consumed_ == 64;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;
+    unsigned consumed_ = 0;
+};
+
+} // namespace mrn
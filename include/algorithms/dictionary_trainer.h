@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mrn {
+
+// 从一批小文件样本中训练共享字典（FastCover 思路）：
+// 统计 8 字节片段在全部样本中的出现次数，每轮挑选覆盖高频片段最多的一段，
+// 选中片段计数清零后继续；得分最高的段放在字典末尾，离待压缩数据最近、偏移最短。
+class DictionaryTrainer {
+public:
+    static constexpr size_t kDefaultDictionarySize = 32 * 1024;
+    static constexpr size_t kSegmentSize = 256;
+
+    // samples 为各样本首尾相接的数据，sampleSizes 为各样本长度；样本不足时返回的字典可能短于 dictionarySize
+    static std::vector<uint8_t> train(const std::vector<uint8_t>& samples,
+                                      const std::vector<size_t>& sampleSizes,
+                                      size_t dictionarySize = kDefaultDictionarySize);
+};
+
+} // namespace mrn
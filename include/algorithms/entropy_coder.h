@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "algorithms/huffman_encoder.h"
+#include "algorithms/tans_encoder.h"
+
+namespace mrn {
+
+enum class EntropyBackend {
+    Auto,    // 每块估算 Huffman 与 tANS 的代价，取较小者
+    Huffman,
+    Tans,
+    Raw,
+};
+
+// MoveRun 的末级熵编码：按块切分，每块独立选择 Huffman / tANS / 原样存储
+class EntropyCoder {
+public:
+    static constexpr size_t kBlockSize = 128 * 1024;
+
+    // 解析 AlgorithmConfig 中的 "entropy" 取值，未知取值抛出异常
+    static EntropyBackend parseBackend(const std::string& name);
+
+    std::vector<uint8_t> encode(const uint8_t* data, size_t size, EntropyBackend backend) const;
+    std::vector<uint8_t> decode(const uint8_t* data, size_t size) const;
+
+private:
+    HuffmanEncoder huffman_;
+    TansEncoder tans_;
+
+    EntropyBackend chooseBackend(const uint8_t* data, size_t size) const;
+};
+
+} // namespace mrn
@@ -1,37 +1,30 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <map>
-#include <queue>
 #include <vector>
 
 namespace mrn {
 
-struct HuffmanNode {
-    uint8_t symbol = 0;
-    uint64_t frequency = 0;
-    HuffmanNode* left = nullptr;
-    HuffmanNode* right = nullptr;
-    
-    bool isLeaf() const { return left == nullptr && right == nullptr; }
-};
-
+// 规范（canonical）、长度受限的 Huffman 编码器。
+// 码长以 4 位半字节存储，编码使用 64 位位写入器，解码使用多位查表。
 class HuffmanEncoder {
 public:
+    static constexpr unsigned kMaxCodeLength = 11;
+
     std::vector<uint8_t> encode(const std::vector<uint8_t>& data) const;
+    std::vector<uint8_t> encode(const uint8_t* data, size_t size) const;
     std::vector<uint8_t> decode(const std::vector<uint8_t>& data) const;
+    std::vector<uint8_t> decode(const uint8_t* data, size_t size) const;
+
+    // 根据 256 个符号的频率计算码长（不超过 maxLength），未出现的符号码长为 0
+    static void buildCodeLengths(const uint64_t* frequencies, uint8_t* lengths, unsigned maxLength);
+
+    // 给定码长时的编码位数估算（不含表头），供上层选择熵编码器
+    static uint64_t encodedBits(const uint64_t* frequencies, const uint8_t* lengths);
 
 private:
-    struct NodeCompare {
-        bool operator()(const HuffmanNode* a, const HuffmanNode* b) {
-            return a->frequency > b->frequency;
-        }
-    };
-    
-    HuffmanNode* buildTree(const std::map<uint8_t, uint64_t>& frequencies) const;
-    void buildCodeTable(HuffmanNode* root, std::map<uint8_t, std::vector<bool>>& codes,
-                       std::vector<bool> code = {}) const;
-    void deleteTree(HuffmanNode* node) const;
+    std::vector<uint8_t> decodeLegacy(const uint8_t* data, size_t size) const;
 };
 
 } // namespace mrn
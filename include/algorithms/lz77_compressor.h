@@ -1,18 +1,39 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
+#include "algorithms/lz_match_finder.h"
+
 namespace mrn {
 
-struct LZ77CompressedBlock {
-    std::vector<uint8_t> buffer;
-    bool isCompressed = true;
+// 原生 LZ 引擎的输出：字面量、长度、偏移三条独立的令牌流，交由熵编码阶段分别编码
+struct LZ77Streams {
+    uint64_t originalSize = 0;
+    uint64_t sequenceCount = 0;
+    std::vector<uint8_t> literals; // 字面量字节
+    std::vector<uint8_t> lengths;  // 每个序列的字面量长度与匹配长度（255 转义 + varint）
+    std::vector<uint8_t> offsets;  // 偏移按字节平面存放：先全部低字节，再中字节、高字节；0 表示重复上一偏移
 };
 
 class LZ77Compressor {
 public:
-    LZ77CompressedBlock compress(const std::vector<uint8_t>& data) const;
+    static constexpr unsigned kMaxWindowLog = 20;
+    static constexpr int kMinLevel = 1;
+    static constexpr int kMaxLevel = 9;
+
+    // 各压缩级别的匹配查找参数：级别越高窗口越大、搜索越深
+    static LZLevelParams levelParams(int level);
+
+    // 原生 LZ 引擎；dictionary 非空时作为数据之前的窗口内容参与匹配，解压须提供同一字典
+    LZ77Streams compressStreams(const uint8_t* data, size_t size, int level,
+                                const uint8_t* dictionary = nullptr, size_t dictionarySize = 0) const;
+    std::vector<uint8_t> decompressStreams(const LZ77Streams& streams,
+                                           const uint8_t* dictionary = nullptr,
+                                           size_t dictionarySize = 0) const;
+
+    // zlib inflate，仅用于读取旧格式负载
     std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
                                     uint64_t expectedSize,
                                     bool isCompressed) const;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mrn {
+
+struct LZMatch {
+    uint32_t length = 0;
+    uint32_t offset = 0;
+};
+
+// 单个压缩级别的匹配查找与解析参数
+struct LZLevelParams {
+    unsigned windowLog = 16;
+    unsigned hashLog = 15;
+    unsigned searchDepth = 1;  // 每个位置最多检查的候选数
+    unsigned lazyDepth = 0;    // 0 = 贪心，1/2 = 向后看 1/2 个位置
+    unsigned niceLength = 32;  // 找到不短于该长度的匹配即停止搜索
+    bool binaryTree = false;   // false = 哈希链，true = 二叉树
+    bool sparseInsert = false; // 匹配内部的位置不入表（最快级别）
+    unsigned optimalPasses = 0; // > 0 时按熵编码代价做最优解析，为代价模型的最大迭代轮数
+};
+
+constexpr uint32_t kLZMinMatch = 4;
+constexpr size_t kLZMaxMatchesPerPosition = 64;
+
+// 哈希链匹配查找：head 记录每个哈希桶最近的位置，chain 按窗口循环记录前驱
+class HashChainMatchFinder {
+public:
+    HashChainMatchFinder(const uint8_t* data, size_t size, const LZLevelParams& params);
+
+    // 插入 pos 之前尚未入表的位置及 pos 本身，并按长度严格递增写出 pos 处的匹配
+    size_t findMatches(size_t pos, LZMatch* matches);
+
+    // 跳过 [nextInsert, pos) 的入表（仅 sparseInsert 模式使用）
+    void advance(size_t pos);
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    LZLevelParams params_;
+    uint32_t windowSize_;
+    uint32_t windowMask_;
+    std::vector<uint32_t> head_;
+    std::vector<uint32_t> chain_;
+    size_t nextInsert_ = 0;
+
+    void insert(size_t pos);
+};
+
+// 二叉树匹配查找（LZMA bt4 思路）：每个位置是一棵按后缀排序的二叉树的根，
+// 查找与插入同时完成，深度受 searchDepth 限制
+class BinaryTreeMatchFinder {
+public:
+    BinaryTreeMatchFinder(const uint8_t* data, size_t size, const LZLevelParams& params);
+
+    size_t findMatches(size_t pos, LZMatch* matches);
+    void advance(size_t pos);
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    LZLevelParams params_;
+    uint32_t windowSize_;
+    uint32_t windowMask_;
+    std::vector<uint32_t> head_;
+    std::vector<uint32_t> tree_;
+    size_t nextInsert_ = 0;
+
+    size_t update(size_t pos, LZMatch* matches);
+};
+
+// 从 a、b 开始比较，返回相同前缀长度（不超过 limit）
+size_t lzCommonLength(const uint8_t* a, const uint8_t* b, size_t limit);
+
+} // namespace mrn
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -9,10 +11,23 @@ struct MoveOptimizerResult {
     std::vector<uint8_t> data;
 };
 
+// 块排序变换：BWT（SA-IS 构造后缀数组）→ MTF → 零游程编码。
+// 输入按 blockSize 切块独立变换，每块压缩约需 8 字节/输入字节、还原约需 6 字节/输入字节，
+// 与总输入大小无关，可在并行工作线程中使用。
 class MoveOptimizer {
 public:
-    MoveOptimizerResult optimize(const std::vector<uint8_t>& input,
-                                 const std::string& mode) const;
+    static constexpr size_t kMinBlockSize = 64 * 1024;
+    static constexpr size_t kMaxBlockSize = 8 * 1024 * 1024;
+    static constexpr size_t kDefaultBlockSize = 900 * 1024;
+
+    // mode 为 "bwt"（"default" 同义）时执行块排序变换，"none" 时原样输出
+    MoveOptimizerResult optimize(const uint8_t* input,
+                                 size_t size,
+                                 const std::string& mode,
+                                 size_t blockSize = kDefaultBlockSize) const;
+
+    // optimize 的逆变换
+    std::vector<uint8_t> restore(const uint8_t* data, size_t size) const;
 };
 
 } // namespace mrn
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mrn {
+
+// SA-IS 线性时间后缀数组构造（Nong-Zhang-Chan），供块排序变换使用。
+// 除返回的数组外，额外内存约为 3 字节/输入字节（16 位文本副本与类型表）。
+// 输入长度须小于 2^31 - 1。
+std::vector<int32_t> buildSuffixArray(const uint8_t* data, size_t size);
+
+} // namespace mrn
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mrn {
+
+// 表驱动的非对称数系（tANS/FSE）熵编码器。
+// 频率归一化到 2^tableLog，编解码均为查表 + 位移，无逐符号分支；使用两个交错状态提高指令并行度。
+class TansEncoder {
+public:
+    static constexpr unsigned kMinTableLog = 5;
+    static constexpr unsigned kMaxTableLog = 12;
+    static constexpr unsigned kDefaultTableLog = 11;
+
+    std::vector<uint8_t> encode(const std::vector<uint8_t>& data) const;
+    std::vector<uint8_t> encode(const uint8_t* data, size_t size) const;
+    std::vector<uint8_t> decode(const std::vector<uint8_t>& data) const;
+    std::vector<uint8_t> decode(const uint8_t* data, size_t size) const;
+
+    // 为给定频率选择表大小
+    static unsigned chooseTableLog(const uint64_t* frequencies, uint64_t total);
+
+    // 将频率归一化为总和 2^tableLog 的计数，出现过的符号至少为 1
+    static void normalizeCounts(const uint64_t* frequencies, uint64_t total,
+                                unsigned tableLog, uint16_t* normalized);
+
+    // 估算编码位数（不含表头），供上层选择熵编码器
+    static uint64_t encodedBits(const uint64_t* frequencies, const uint16_t* normalized, unsigned tableLog);
+};
+
+} // namespace mrn
@@ -1,22 +1,37 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace mrn {
 
+class ICompressionAlgorithm;
+
+// 版本 3 起条目目录移到归档末尾，由固定长度的尾部定位；1、2 版为紧跟数据区的定长条目表。
+// 版本 4 起目录条目另记录压缩所用算法的 ID 与参数，版本 5 起另记录文件修改时间
+constexpr uint8_t MRN_ARCHIVE_VERSION = 5;
+
 #pragma pack(push, 1)
 struct MRNArchiveHeader {
     char magic[3] = {'M', 'R', 'N'};
-    uint8_t version = 2;
+    uint8_t version = MRN_ARCHIVE_VERSION;
     uint16_t flags = 0;
     uint64_t creationTime = 0;
     uint32_t fileCount = 0;
     uint64_t totalUncompressedSize = 0;
     uint64_t totalCompressedSize = 0;
     uint8_t compressionPipelineId = 0;
-    char reserved[16] = {0};
+    uint16_t entryHeaderSize = 0; // 2 版：每个 FileEntryHeader 的字节数，0 表示旧版 288 字节；3 版起不使用
+    uint64_t dictionaryOffset = 0; // 共享字典在归档中的位置，dictionarySize 为 0 表示没有字典
+    uint32_t dictionarySize = 0;
+    char reserved[2] = {0};
 };
 
+// 1、2 版归档的定长条目，文件名超过 255 字节时被截断
 struct FileEntryHeader {
     char filename[256] = {0};
     uint64_t uncompressedSize = 0;
@@ -26,11 +41,150 @@ struct FileEntryHeader {
     uint16_t permissions = 0;
     uint8_t compressionLevel = 0;
     uint8_t flags = 0;
+    // 以下为扩展字段，旧版归档中读出为 0
+    uint8_t preprocessorCount = 0;
+    uint32_t preprocessorIds[4] = {0};
+    uint64_t transformedSize = 0; // 预处理后、主算法压缩前的大小
+    uint8_t entryType = 0;        // MRN_ENTRY_*
+    uint32_t solidBlock = 0;      // 固实成员所在块的条目序号；此时 fileOffset 为块内偏移
+};
+
+// 3 版起归档的最后 44 字节，定位数据区之后依次存放的目录页、页表和名称索引。
+// 目录按每页 entriesPerPage 个条目分页，页内路径前缀编码（与上一条目共享的前缀长度 + 剩余部分），
+// 大小、偏移等整数为 varint；每页单独压缩，查找单个条目时只需读取并解码所在的一页。
+// 页表每页一项 [varint 存储大小][varint 原始大小][u32 CRC32C]，存储大小小于原始大小表示该页已压缩。
+// 名称索引为 nameIndexSlots 个 6 字节槽位的开放寻址哈希表：
+// [u16 路径哈希高 16 位][u32 条目序号 + 1]，序号为 0 表示空槽，从槽位 (哈希 % 槽数) 开始线性探测
+struct MRNArchiveFooter {
+    uint64_t directoryOffset = 0;
+    uint64_t pageTableOffset = 0;
+    uint64_t nameIndexOffset = 0;
+    uint32_t entriesPerPage = 0;
+    uint32_t nameIndexSlots = 0;
+    uint32_t directoryAlgorithm = 0; // 压缩目录页所用算法的 ID，0 表示各页均原样存储
+    uint32_t pageTableChecksum = 0;  // 页表的 CRC32C
+    char magic[4] = {'M', 'R', 'N', 'D'};
 };
 #pragma pack(pop)
 
+// 内存中的条目，字段含义同 FileEntryHeader，路径长度不受限制
+struct ArchiveEntry {
+    std::string name;
+    uint64_t uncompressedSize = 0;
+    uint64_t compressedSize = 0;
+    uint64_t fileOffset = 0;
+    uint32_t checksum = 0;
+    uint16_t permissions = 0;
+    uint8_t compressionLevel = 0;
+    uint8_t flags = 0;
+    uint8_t preprocessorCount = 0;
+    uint32_t preprocessorIds[4] = {0};
+    uint64_t transformedSize = 0;
+    uint8_t entryType = 0;
+    uint32_t solidBlock = 0;
+    // 压缩负载所用算法的 ID 与参数，解压时按 ID 选择算法；0 表示旧版归档，使用默认算法
+    uint32_t algorithmId = 0;
+    std::map<std::string, std::string> algorithmParams;
+    uint64_t modifiedTime = 0; // 文件修改时间（Unix 纪元起的纳秒数），0 表示未记录
+};
+
+struct ArchiveDirectory {
+    MRNArchiveHeader header;
+    std::vector<ArchiveEntry> entries;
+};
+
+constexpr size_t MRN_LEGACY_ENTRY_HEADER_SIZE = 288;
+constexpr size_t MRN_MAX_PREPROCESSORS = 4;
+
+// 条目类型：固实块条目不对应文件，其负载解压后是若干成员文件的拼接；
+// 成员条目自身没有负载，按 (solidBlock, fileOffset, uncompressedSize) 从块中取出
+constexpr uint8_t MRN_ENTRY_FILE = 0;
+constexpr uint8_t MRN_ENTRY_SOLID_BLOCK = 1;
+constexpr uint8_t MRN_ENTRY_SOLID_MEMBER = 2;
+
 constexpr uint8_t MRN_FILE_FLAG_COMPRESSED = 0x01;
+// 记录压缩时实际执行的流水线阶段
+constexpr uint8_t MRN_FILE_FLAG_STAGE_MOVE = 0x02;
+constexpr uint8_t MRN_FILE_FLAG_STAGE_LZ = 0x04;
+constexpr uint8_t MRN_FILE_FLAG_STAGE_ENTROPY = 0x08;
+constexpr uint8_t MRN_FILE_FLAG_STAGE_MASK = 0x0E;
+// 去重模式：条目负载是块引用列表，块数据在归档中独立存放并可被多个条目共享
+constexpr uint8_t MRN_FILE_FLAG_CHUNKED = 0x10;
+// 条目以归档的共享字典预热压缩，解压时须加载同一字典
+constexpr uint8_t MRN_FILE_FLAG_DICTIONARY = 0x20;
+// 大文件切块独立压缩：负载为各块数据，之后是块表和 4 字节块表长度；
+// 条目 checksum 为全部原始数据的 CRC32（由各块 CRC32 合并得到）
+constexpr uint8_t MRN_FILE_FLAG_BLOCKED = 0x40;
+// checksum 为原始数据的 CRC32C，解压时校验；未设置时为旧版本写入的值，不校验。
+// 切块条目的块记录同样带此标志，块 CRC 与合并方式随之改为 CRC32C
+constexpr uint8_t MRN_FILE_FLAG_CRC32C = 0x80;
 
 bool validateHeader(const MRNArchiveHeader& header);
 
+// 名称索引使用的路径哈希（64 位 FNV-1a），属于归档格式的一部分
+uint64_t hashEntryName(const std::string& name);
+
+// 编码当前版本的目录（目录页、页表、名称索引），offset 为其在归档中的起始位置，同时填写 footer；
+// codec 非空时各页在压缩后更小的情况下以其压缩
+std::vector<uint8_t> encodeDirectory(const std::vector<ArchiveEntry>& entries,
+                                     ICompressionAlgorithm* codec,
+                                     uint64_t offset,
+                                     MRNArchiveFooter& footer);
+
+// 归档目录的读取端。构造时读取归档头；3 版起另从文件末尾一次读入尾部、页表，
+// 目录较小时连同名称索引与目录页都在这一次读取中。目录页按尾部记录的算法 ID 解压，格式错误时抛出异常。
+// 也可直接读取已映射到内存的归档（见 ArchiveReader），此时各部分按偏移取自映射，不再经过流
+class DirectoryReader {
+public:
+    explicit DirectoryReader(std::istream& archive);
+    // data 在读取器的生命周期内须保持有效
+    DirectoryReader(const uint8_t* data, uint64_t size);
+
+    const MRNArchiveHeader& header() const { return header_; }
+
+    // 数据区的结束位置，即条目目录的起始偏移
+    uint64_t dataEnd() const;
+
+    // 全部条目；3 版一次读入所有目录页，旧版一次读入整个定长条目表
+    std::vector<ArchiveEntry> readAll();
+
+    // 按完整路径查找条目。3 版只读取名称索引中探测到的槽位和命中条目所在的一页，
+    // 旧版在全部条目中查找
+    bool find(const std::string& name, uint32_t& index);
+
+    // 读取单个条目，所在目录页解码后缓存
+    const ArchiveEntry& entry(uint32_t index);
+
+private:
+    struct Page {
+        uint64_t offset = 0;
+        uint64_t storedSize = 0;
+        uint64_t rawSize = 0;
+        uint32_t checksum = 0;
+    };
+
+    std::istream* archive_ = nullptr;
+    const uint8_t* mapped_ = nullptr;
+    uint64_t mappedSize_ = 0;
+    MRNArchiveHeader header_{};
+    MRNArchiveFooter footer_{};
+    std::vector<Page> pages_;
+    std::vector<uint8_t> tail_; // 归档末尾已读入的部分
+    uint64_t tailOffset_ = 0;
+    std::map<uint32_t, std::vector<ArchiveEntry>> loadedPages_;
+    std::vector<ArchiveEntry> legacyEntries_;
+    bool legacyLoaded_ = false;
+
+    void open();
+    void openFooter();
+    uint64_t archiveSize();
+    void readAt(uint64_t offset, uint8_t* out, uint64_t size);
+    std::vector<uint8_t> readRange(uint64_t offset, uint64_t size);
+    std::vector<ArchiveEntry> decodePage(uint32_t index, const uint8_t* stored);
+    const std::vector<ArchiveEntry>& legacyEntries();
+};
+
+// 读取归档头与全部条目
+ArchiveDirectory readArchiveDirectory(std::istream& archive);
+
 } // namespace mrn
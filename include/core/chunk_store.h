@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/content_chunker.h"
+
+namespace mrn {
+
+// 已压缩的块负载
+struct StoredChunk {
+    std::vector<uint8_t> payload;
+    uint64_t uncompressedSize = 0;
+    bool isCompressed = false;
+};
+
+// 去重模式下各工作线程共享的块表。
+// 首个遇到某块的线程负责压缩并 publish，其余线程只记录块编号；
+// 主线程按文件顺序写归档时通过 slot() 取得负载并记录偏移，每个唯一块只写一次。
+class ChunkStore {
+public:
+    struct Slot {
+        std::promise<StoredChunk> promise;
+        std::shared_future<StoredChunk> chunk;
+        // 以下字段只由写归档的线程访问
+        bool written = false;
+        uint64_t offset = 0;
+        uint64_t compressedSize = 0;
+        uint64_t uncompressedSize = 0;
+        bool isCompressed = false;
+    };
+
+    // 返回块编号；块首次出现时 owner 置为 true，调用方须随后调用 publish 或 fail
+    uint32_t acquire(const ChunkDigest& digest, bool& owner);
+    void publish(uint32_t id, StoredChunk chunk);
+    void fail(uint32_t id, std::exception_ptr error);
+
+    // 返回的引用在 ChunkStore 生命周期内保持有效
+    Slot& slot(uint32_t id);
+
+    size_t uniqueChunks() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<ChunkDigest, uint32_t, ChunkDigestHash> index_;
+    std::deque<Slot> slots_;
+};
+
+} // namespace mrn
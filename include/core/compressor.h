@@ -1,6 +1,8 @@
 #pragma once
 
+#include <functional>
 #include <future>
+#include <iosfwd>
 #include <map>
 #include <memory>
 #include <string>
@@ -8,16 +10,35 @@
 
 #include "core/plugin_manager.h"
 #include "io/directory_scanner.h"
+#include "utils/byte_view.h"
 #include "utils/thread_pool.h"
 
 namespace mrn {
 
+// 竞速模式的选择目标
+enum class RaceObjective {
+    Off,
+    Ratio, // 样本压缩后最小，完整数据上不大于配置的默认设置
+    Speed, // 压缩后不超过 raceSizeBound 的候选中压缩最快
+};
+
 struct CompressionOptions {
     int compressionLevel = 6;
     bool overwrite = false;
     bool verbose = false;
     bool skipCompression = false; // 跳过压缩，直接存储（用于已压缩文件）
+    bool autoDetectPreset = false; // 目录压缩时为每个文件按类型检测预设
+    bool dedup = false; // 目录压缩时按内容分块，跨文件共享重复块
+    bool trainDictionary = true; // 目录中小文件足够多时训练共享字典
+    std::string dictionaryName; // 复用已保存的共享字典（见 ConfigurationManager），跳过训练
+    std::string saveDictionaryName; // 将本次使用的共享字典保存为该名称
+    size_t solidBlockSize = 0; // 大于 0 时启用固实模式：小文件按预设分组拼接成该大小的块再压缩
+    size_t splitBlockSize = 8 * 1024 * 1024; // 单文件压缩时超过该大小即切块并行压缩，0 表示不切块
     size_t batchSize = 4;
+    RaceObjective raceObjective = RaceObjective::Off; // 压缩前以样本试压各已注册算法的各级别，按目标选用
+    double raceSizeBound = 1.0; // Speed 目标下样本压缩后与原始大小之比的上限
+    std::string referenceArchive; // 增量归档：目录压缩时从该归档复制路径、大小与修改时间都未变的条目
+    bool referenceVerifyHash = false; // 增量归档时另核对文件内容的 CRC32C
     ScanOptions scanOptions;
 };
 
@@ -34,10 +55,29 @@ struct FileCompressionResult {
     uint16_t filePermissions = 0;
     uint64_t modifiedTime = 0;
     uint32_t checksum = 0;
+    uint8_t compressionLevel = 0;
+    std::vector<uint32_t> preprocessorIds; // 实际执行的预处理器链
+    uint64_t transformedSize = 0;
+    bool chunked = false; // 去重模式：数据以块形式存放在 ChunkStore 中
+    std::vector<uint32_t> chunkIds;
+    uint8_t entryType = 0; // MRN_ENTRY_*
+    uint32_t solidBlock = 0; // 固实成员所在块的条目序号
+    uint64_t solidOffset = 0; // 固实成员在块解压数据中的偏移
+    bool blocked = false; // 切块条目：各块已通过 writeBlob 写入，compressedData 为块表
+    bool streamed = false; // 流式条目：负载已边压缩边写入，compressedData 为流结束时的剩余输出
+    uint64_t payloadOffset = 0; // 切块、流式条目的负载在归档中的起始偏移
+    uint64_t blockBytes = 0; // 切块、流式条目已先行写入的字节数
+    uint32_t algorithmId = 0; // 压缩所用算法的 ID，原样存储时为 0
+    std::map<std::string, std::string> algorithmParams; // 压缩所用的算法参数
 };
 
 class DirectoryScanner;
 class ArchiveWriter;
+class ArchiveReader;
+class PipelineExecutor;
+class ChunkStore;
+struct BlockRecord;
+struct ArchiveEntry;
 
 class ModularCompressor {
 public:
@@ -53,8 +93,24 @@ public:
                                          const CompressionPipeline& pipeline,
                                          const CompressionOptions& options);
 
+    // 流式压缩：从输入流边读边压缩为单个条目，内存占用与输入长度无关（用于 stdin）
+    CompressionResult compressStream(std::istream& input,
+                                     const std::string& entryName,
+                                     const std::string& outputFile,
+                                     const CompressionPipeline& pipeline,
+                                     const CompressionOptions& options);
+
+    // 把文件或目录（其中文件以相对目录的路径为条目名）追加到已有归档，只重写归档末尾的目录；
+    // 路径与归档中已有条目重复时抛出异常。中断的追加在下次打开归档时回滚（见 ArchiveWriter）
+    CompressionResult append(const std::string& archiveFile,
+                             const std::vector<std::string>& inputPaths,
+                             const CompressionPipeline& pipeline,
+                             const CompressionOptions& options);
+
+    // selection 非空时只解压与其中路径或通配符匹配的条目，只读取这些条目的数据
     DecompressionResult decompress(const std::string& inputFile,
-                                   const std::string& outputPath);
+                                   const std::string& outputPath,
+                                   const std::vector<std::string>& selection = {});
 
     // 列出归档内容
     void listArchive(const std::string& inputFile);
@@ -62,7 +118,17 @@ public:
     // 测试归档完整性
     bool testArchive(const std::string& inputFile);
 
+    // 读取条目原始数据中从 offset 起的 length 字节（超出条目末尾的部分截去）。
+    // 切块条目只读取并解码覆盖该范围的块，原样存储的条目直接读取对应字节，其余条目整体解码后截取
+    std::vector<uint8_t> readRange(const std::string& inputFile,
+                                   const std::string& entryName,
+                                   uint64_t offset,
+                                   uint64_t length);
+
     void setDefaultPipeline(const std::string& preset);
+
+    // 解压时在途数据（已读入的负载与待写出的原始数据）的上限
+    void setMemoryBudget(size_t bytes) { extractMemoryBudget_ = bytes; }
     CompressionPipeline createCustomPipeline(const std::vector<std::string>& steps);
 
 private:
@@ -70,11 +136,107 @@ private:
     std::unique_ptr<ThreadPool> threadPool_;
     std::unique_ptr<DirectoryScanner> directoryScanner_;
     CompressionPipeline defaultPipeline_;
+    size_t extractMemoryBudget_ = 256 * 1024 * 1024;
+
+    // 固实块：块条目与按顺序排列的成员条目
+    struct SolidBlockResult {
+        FileCompressionResult block;
+        std::vector<FileCompressionResult> members;
+    };
 
     FileCompressionResult compressSingleFile(const std::string& filepath,
                                              const std::string& archivePath,
                                              const CompressionPipeline& pipeline,
-                                             const CompressionOptions& options);
+                                             const CompressionOptions& options,
+                                             const std::vector<uint8_t>* dictionary = nullptr);
+
+    // 预处理链 + 主算法压缩一段数据，无收益时退化为原样存储
+    void compressBuffer(ByteView data,
+                        const CompressionPipeline& pipeline,
+                        const CompressionOptions& options,
+                        const std::vector<uint8_t>* dictionary,
+                        FileCompressionResult& result);
+
+    // 竞速模式：以数据样本试压各已注册算法的每个级别，把按 options.raceObjective 选出的算法与级别
+    // 写回 pipeline 与 options；不压缩或数据过小时保持不变
+    void raceAlgorithms(ByteView data,
+                        const std::vector<uint8_t>* dictionary,
+                        CompressionPipeline& pipeline,
+                        CompressionOptions& options);
+
+    // 竞速后以选中的算法与级别压缩 data，结果写入 result（调用方预先填好元数据）。按 Ratio 目标且选中者
+    // 不同于配置时，另以配置的算法与级别压缩完整数据，保留较小者；实际采用的设置写回 pipeline 与 options
+    void compressRaced(ByteView data,
+                       const std::vector<uint8_t>* dictionary,
+                       CompressionPipeline& pipeline,
+                       CompressionOptions& options,
+                       FileCompressionResult& result);
+
+    // 大文件切块：按顺序读入、在线程池上并行压缩，按序写出，同时在途的块数有上限
+    FileCompressionResult compressBlockedFile(const std::string& filepath,
+                                              const std::string& archivePath,
+                                              const CompressionPipeline& pipeline,
+                                              const CompressionOptions& options,
+                                              ArchiveWriter& writer);
+
+    // 逐块解码切块条目并按顺序交给 sink，校验每块及整体的 CRC32
+    void decodeBlockedEntry(const ArchiveEntry& entry,
+                            PipelineExecutor& executor,
+                            const ArchiveReader& archive,
+                            const std::function<void(const std::vector<uint8_t>&)>& sink);
+
+    // 解码切块条目 entry 中的一块并校验其 CRC32
+    std::vector<uint8_t> decodeBlock(const ArchiveEntry& entry,
+                                     const BlockRecord& record,
+                                     ByteView payload,
+                                     PipelineExecutor& executor);
+
+    // 拼接一组小文件并整体压缩
+    SolidBlockResult compressSolidBlock(const std::vector<DirectoryScanner::FileInfo>& files,
+                                        const CompressionPipeline& pipeline,
+                                        const CompressionOptions& options);
+
+    // 按选项加载或从小文件样本训练共享字典；不适用时返回空
+    std::vector<uint8_t> prepareDictionary(const std::vector<DirectoryScanner::FileInfo>& files,
+                                           const CompressionPipeline& pipeline,
+                                           const CompressionOptions& options);
+
+    // 去重模式：按内容分块，仅压缩首次出现的块
+    FileCompressionResult compressChunkedFile(const std::string& filepath,
+                                              const std::string& archivePath,
+                                              const CompressionPipeline& pipeline,
+                                              const CompressionOptions& options,
+                                              ChunkStore& store,
+                                              const std::vector<uint8_t>* dictionary);
+
+    // 写出条目引用的新块，并把块引用列表作为条目负载
+    void resolveChunkRefs(ArchiveWriter& writer, ChunkStore& store, FileCompressionResult& result);
+
+    // 按条目记录的算法 ID 取得解压算法，未注册时抛出异常
+    ICompressionAlgorithm& algorithmFor(const ArchiveEntry& entry);
+
+    // 还原条目原始数据，并按条目标志核对 CRC32C，不一致时抛出异常
+    std::vector<uint8_t> decodeEntry(const ArchiveEntry& entry,
+                                     ByteView payload,
+                                     PipelineExecutor& executor,
+                                     const ArchiveReader* archive,
+                                     const std::vector<uint8_t>* dictionary);
+
+    // 同 decodeEntry，但原样存储的条目直接返回负载本身（如映射中的视图），不复制；
+    // 需要解码时结果存入 storage，返回指向它的视图
+    ByteView restoreEntry(const ArchiveEntry& entry,
+                          ByteView payload,
+                          PipelineExecutor& executor,
+                          const ArchiveReader* archive,
+                          const std::vector<uint8_t>* dictionary,
+                          std::vector<uint8_t>& storage);
+
+    // 主算法解压后按条目记录的链执行逆预处理；分块与切块条目从 archive 读取引用的块，其余条目 archive 可为空
+    std::vector<uint8_t> decodePayload(const ArchiveEntry& entry,
+                                     ByteView payload,
+                                     PipelineExecutor& executor,
+                                     const ArchiveReader* archive,
+                                     const std::vector<uint8_t>* dictionary);
 };
 
 } // namespace mrn
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "core/compressor.h"
 
@@ -27,11 +29,21 @@ public:
     CompressionPreset getPreset(const std::string& name);
     void addCustomPreset(const std::string& name, const CompressionPreset& preset);
 
+    // 按内容（魔数、抽样熵）与扩展名为文件选择预设
     CompressionPreset detectBestPreset(const std::string& filename);
+    // 只按名称选择预设，用于没有文件可读的输入（如标准输入）
+    CompressionPreset detectPresetByName(const std::string& filename);
+
+    // 共享字典按名称存放在字典目录下（<name>.dict），供多个归档复用；
+    // 名称含路径分隔符时直接作为文件路径
+    std::string dictionaryPath(const std::string& name) const;
+    std::vector<uint8_t> loadDictionary(const std::string& name) const;
+    void saveDictionary(const std::string& name, const std::vector<uint8_t>& dictionary) const;
 
 private:
     std::map<std::string, CompressionPreset> presets_;
     std::map<std::string, std::string> fileAssociations_;
+    std::string dictionaryDirectory_; // 为空时使用 MRN_DICT_DIR 或 ~/.mrn/dictionaries
 };
 
 } // namespace mrn
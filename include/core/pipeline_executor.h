@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/plugin_manager.h"
+
+namespace mrn {
+
+// 预处理器链的执行器：各级在两个复用的缓冲区之间交替读写，不为每一级分配新向量。
+// 每个执行器只能由一个线程使用。
+class PipelineExecutor {
+public:
+    explicit PipelineExecutor(PluginManager& pluginManager);
+
+    // 按名称解析链；未注册、未分配 ID 或超过长度上限时抛出异常
+    std::vector<IPreprocessor*> resolve(const std::vector<std::string>& names) const;
+    // 按条目头中记录的 ID 解析链
+    std::vector<IPreprocessor*> resolve(const uint32_t* ids, size_t count) const;
+
+    // 依次执行正向变换；链为空时直接返回 input，否则返回内部缓冲区的视图（下次调用前有效）
+    ByteView forward(const std::vector<IPreprocessor*>& chain, ByteView input);
+    // 按相反顺序执行逆变换
+    ByteView inverse(const std::vector<IPreprocessor*>& chain, ByteView input);
+
+private:
+    PluginManager& pluginManager_;
+    std::vector<uint8_t> buffers_[2];
+};
+
+} // namespace mrn
@@ -3,9 +3,12 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "utils/byte_view.h"
+
 namespace mrn {
 
 struct AlgorithmConfig {
@@ -22,12 +25,17 @@ struct CompressParams {
     AlgorithmConfig config;
     int level = 6;
     std::string mode = "default";
+    const std::vector<uint8_t>* dictionary = nullptr; // 共享字典，为空表示不使用
+    // 大于 0 时允许算法提前放弃：开头部分压缩后仍不小于原始大小的该比例，
+    // 就不再压缩其余数据，返回 isCompressed 为 false 且不追加负载，由调用方原样存储
+    double incompressibleRatio = 0.0;
 };
 
 struct CompressionResult {
     std::vector<uint8_t> compressedData;
     uint64_t uncompressedSize = 0;
     bool isCompressed = true;
+    uint8_t stages = 0; // 实际执行的流水线阶段（MRN_FILE_FLAG_STAGE_*），写入条目 flags
 };
 
 struct DecompressionResult {
@@ -38,6 +46,17 @@ struct DecompressParams {
     AlgorithmConfig config;
     uint64_t expectedSize = 0;
     bool dataIsCompressed = true;
+    const std::vector<uint8_t>* dictionary = nullptr; // 压缩时使用的同一份共享字典
+};
+
+// 增量压缩会话：输出追加到调用方提供的缓冲区，调用方可随时取走并清空，
+// 内存占用只取决于算法的帧大小，与输入总长无关
+class ICompressionStream {
+public:
+    virtual ~ICompressionStream() = default;
+    virtual void feed(const uint8_t* data, size_t size, std::vector<uint8_t>& output) = 0;
+    // 写出剩余数据并结束会话；返回值的 compressedData 为空，其余字段描述整个流
+    virtual CompressionResult finish(std::vector<uint8_t>& output) = 0;
 };
 
 class ICompressionAlgorithm {
@@ -48,14 +67,37 @@ public:
     virtual std::string getVersion() const = 0;
     virtual uint32_t getAlgorithmId() const = 0;
 
-    virtual CompressionResult compress(const CompressParams& params,
-                                       const std::vector<uint8_t>& data) = 0;
+    // 压缩 data，负载追加到 result.compressedData 末尾，其余字段描述本次压缩。
+    // 输入是只读视图（可直接指向输入文件或归档的映射），输出缓冲区归调用方所有，可跨调用复用
+    virtual void compressInto(const CompressParams& params, ByteView data, CompressionResult& result) = 0;
 
-    virtual DecompressionResult decompress(const DecompressParams& params,
-                                           const std::vector<uint8_t>& data) = 0;
+    // 解压 data，原始数据追加到 output 末尾
+    virtual void decompressInto(const DecompressParams& params, ByteView data, std::vector<uint8_t>& output) = 0;
+
+    // 便捷版本：结果放在新分配的缓冲区中
+    CompressionResult compress(const CompressParams& params, ByteView data) {
+        CompressionResult result;
+        compressInto(params, data, result);
+        return result;
+    }
+
+    DecompressionResult decompress(const DecompressParams& params, ByteView data) {
+        DecompressionResult result;
+        decompressInto(params, data, result.decompressedData);
+        return result;
+    }
 
     virtual AlgorithmCapabilities getCapabilities() const = 0;
 
+    // 开始流式压缩，负载头写入 output；仅当 supportsStreaming 为 true 时可用。
+    // 流式负载与 compress 的结果一样由 decompress 整体解码
+    virtual std::unique_ptr<ICompressionStream> beginStream(const CompressParams& params,
+                                                            std::vector<uint8_t>& output) {
+        (void)params;
+        (void)output;
+        throw std::runtime_error("Streaming not supported by algorithm: " + getName());
+    }
+
     virtual void configure(const AlgorithmConfig& config) = 0;
 };
 
@@ -64,6 +106,18 @@ public:
     virtual ~IPreprocessor() = default;
     virtual std::vector<uint8_t> process(const std::vector<uint8_t>& data) = 0;
     virtual std::vector<uint8_t> inverseProcess(const std::vector<uint8_t>& data) = 0;
+
+    // 写入条目头的稳定 ID，解压时据此找回逆变换；0 表示未分配，不能用于流水线
+    virtual uint32_t getPreprocessorId() const { return 0; }
+
+    // 写入调用方提供的缓冲区，供流水线执行器在两个缓冲区间交替使用；输入可以是映射中的视图。
+    // 默认退化为按值版本，需先把输入复制为 vector
+    virtual void processInto(ByteView input, std::vector<uint8_t>& output) {
+        output = process(input.toVector());
+    }
+    virtual void inverseProcessInto(ByteView input, std::vector<uint8_t>& output) {
+        output = inverseProcess(input.toVector());
+    }
 };
 
 } // namespace mrn
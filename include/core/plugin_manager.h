@@ -23,7 +23,9 @@ public:
     std::vector<std::string> getAvailablePreprocessors() const;
 
     ICompressionAlgorithm* getAlgorithm(const std::string& name);
+    ICompressionAlgorithm* getAlgorithmById(uint32_t id);
     IPreprocessor* getPreprocessor(const std::string& name);
+    IPreprocessor* getPreprocessorById(uint32_t id);
 
     void loadPluginsFromDirectory(const std::string& directory);
 
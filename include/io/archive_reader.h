@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/archive_format.h"
+#include "io/file_io.h"
+#include "utils/byte_view.h"
+
+namespace mrn {
+
+// 归档的读取端：打开时只读映射整个归档，校验归档头与尾部、页表一次，
+// 之后条目负载、块表与共享字典都以视图形式直接取自映射，不经过流读取和中间缓冲。
+// 读取器存续期间持有归档上的共享锁，进行中的追加（持有排他锁）结束前打开会等待。
+// 视图在读取器销毁前有效；view/payload/dictionary 可在多个线程中并发调用，directory/entries 只应由一个线程使用
+class ArchiveReader {
+public:
+    // 预期的访问模式，转为 madvise 提示：顺序访问时内核加大预读，随机访问时关闭预读
+    enum class Access { Sequential, Random };
+
+    // 存在崩溃遗留的追加日志时先回滚，再映射归档
+    explicit ArchiveReader(const std::string& filename);
+    ~ArchiveReader();
+
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    const std::string& filename() const { return filename_; }
+    uint64_t size() const { return size_; }
+    const MRNArchiveHeader& header() const { return directory_->header(); }
+
+    // 按需读取目录页的目录读取器
+    DirectoryReader& directory() { return *directory_; }
+    // 全部条目，首次调用时解码并缓存
+    const std::vector<ArchiveEntry>& entries();
+
+    // 归档中 [offset, offset + size) 的视图，越界时抛出异常
+    ByteView view(uint64_t offset, uint64_t size) const;
+    // 条目负载（fileOffset 起 compressedSize 字节）
+    ByteView payload(const ArchiveEntry& entry) const;
+    // 归档头记录的共享字典，没有时为空视图
+    ByteView dictionary() const;
+
+    void advise(Access access) const;
+    // 提示内核即将读取该范围，提前发起读盘
+    void willNeed(uint64_t offset, uint64_t size) const;
+
+private:
+    std::string filename_;
+    std::unique_ptr<FileLock> lock_;
+    const uint8_t* data_ = nullptr;
+    uint64_t size_ = 0;
+    std::unique_ptr<DirectoryReader> directory_;
+    std::vector<ArchiveEntry> entries_;
+    bool entriesLoaded_ = false;
+};
+
+} // namespace mrn
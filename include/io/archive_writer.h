@@ -8,15 +8,31 @@
 
 #include "core/archive_format.h"
 #include "core/compressor.h"
+#include "io/file_io.h"
+#include "utils/byte_view.h"
 #include "utils/thread_pool.h"
 
 namespace mrn {
 
+// 追加模式：在原数据区末尾（旧目录处）写入新条目，finalize 时重写目录与归档头并截去多余部分。
+// 改动归档前先把旧目录与归档头写入旁路日志 <归档>.journal 并刷盘，finalize 刷盘后再删除日志；
+// 追加中断时日志仍在，recover 据此把归档恢复为追加前的状态；追加因异常中止时析构同样回滚，不提交部分写入。
+// 写入器（新建与追加）存续期间持有归档上的排他锁，读取端（ArchiveReader）持有共享锁，
+// 读取期间不会遇到进行中的重写或追加。
+// 日志格式：[magic "MRNJ"][u64 数据区结束偏移][u64 旧目录长度][MRNArchiveHeader][旧目录][u32 CRC32C]
 class ArchiveWriter {
 public:
-    ArchiveWriter(const std::string& filename, const CompressionPipeline& pipeline);
+    enum class OpenMode { Create, Append };
+
+    ArchiveWriter(const std::string& filename, const CompressionPipeline& pipeline,
+                  OpenMode mode = OpenMode::Create);
     ~ArchiveWriter();
 
+    // 是否留有未完成追加的日志
+    static bool needsRecovery(const std::string& filename);
+    // 存在追加日志时回滚未完成的追加；调用方须持有归档的排他锁，否则可能回滚别的进程正在进行的追加
+    static void recover(const std::string& filename);
+
     bool addFile(const std::string& filepath,
                  const std::string& archivePath,
                  const CompressionOptions& options);
@@ -26,6 +42,19 @@ public:
 
     bool addCompressedFile(const FileCompressionResult& result);
 
+    // 从另一归档原样复制条目及其负载（通常是 ArchiveReader 映射中的视图），只改写负载偏移
+    // （切块条目的块表按条目内相对位置记录）
+    bool copyEntry(const ArchiveEntry& entry, ByteView payload);
+
+    // 已写入的条目数，即下一个条目的序号（固实成员据此引用所在块）
+    uint32_t entryCount();
+
+    // 写入不属于任何条目的数据块（去重块），返回其在归档中的偏移
+    uint64_t writeBlob(const std::vector<uint8_t>& data);
+
+    // 写入归档级共享字典并记录到文件头，每个归档最多调用一次
+    void setDictionary(const std::vector<uint8_t>& dictionary);
+
     bool finalize();
 
     // 多线程文件处理
@@ -33,9 +62,15 @@ public:
                          const CompressionOptions& options);
 
 private:
+    std::string filename_;
+    bool appending_ = false;
+    // 归档上的排他锁，析构时释放
+    std::unique_ptr<FileLock> lock_;
+    // 构造时未捕获的异常数，析构时据此判断是否因异常退出
+    int uncaughtExceptions_ = 0;
     std::ofstream archiveStream_;
     MRNArchiveHeader header_{};
-    std::vector<FileEntryHeader> fileEntries_;
+    std::vector<ArchiveEntry> fileEntries_;
     CompressionPipeline pipeline_;
     uint64_t currentOffset_ = sizeof(MRNArchiveHeader);
     std::unique_ptr<ThreadPool> threadPool_;
@@ -4,12 +4,90 @@
 #include <string>
 #include <vector>
 
+#include "utils/byte_view.h"
+
 namespace mrn {
 
+// 只读映射的输入文件，析构时解除映射；可移动，不可复制。
+// 映射期间文件被截断时，访问新末尾之后的页本会以 SIGBUS 终止进程；mapFile 为映射登记了 SIGBUS 处理，
+// 故障页改以零页代替，读取照常进行，读完后 verify 抛出异常。因此读完映射、写出结果之前必须调用 verify。
+// 文件在原有长度内被改写（而非截断）时无法察觉，读到的可能是新旧内容的混合
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    ByteView view() const { return ByteView(data_, size_); }
+
+    // 打开时（读取内容之前）取得的修改时间与权限位。记录到归档的应是这一时间：
+    // 读取期间文件被改写时，下次增量归档据此发现变化，而不会把不完整的内容当作未变
+    uint64_t modifiedTime() const { return modifiedTime_; }
+    uint16_t permissions() const { return permissions_; }
+
+    // 打开以来文件被截断（读到的内容因此不完整）时抛出异常
+    void verify() const;
+
+private:
+    friend class FileIO;
+    void reset();
+
+    std::string path_;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    int guardSlot_ = -1; // SIGBUS 保护的槽位，读入的小文件为 -1
+    uint64_t modifiedTime_ = 0;
+    uint16_t permissions_ = 0;
+    std::vector<uint8_t> buffer_; // 小文件直接读入，不建立映射
+};
+
+// 文件上的 flock 咨询锁，析构时释放；进程退出（包括崩溃）时内核自动释放。
+// 锁属于各自打开的描述符，同一进程内对同一文件的两把锁同样互斥
+class FileLock {
+public:
+    enum class Mode { Shared, Exclusive };
+
+    // 阻塞直到取得锁；需要等待时先记录一条日志
+    FileLock(const std::string& path, Mode mode);
+    FileLock(FileLock&& other) noexcept;
+    FileLock& operator=(FileLock&& other) = delete;
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    ~FileLock();
+
+    // 转换锁的模式。flock 的转换不是原子的：可能先释放原有的锁，再等待新锁，
+    // 因此转换之后需要重新检查锁所保护的状态
+    void relock(Mode mode);
+
+private:
+    void acquire(Mode mode);
+
+    std::string path_;
+    int fd_ = -1;
+};
+
 class FileIO {
 public:
     static std::vector<uint8_t> readFile(const std::string& path);
-    static void writeFile(const std::string& path, const std::vector<uint8_t>& data);
+    // 读取的同时分段计算 CRC32C，数据刚读入仍在缓存中，不必再单独遍历一遍
+    static std::vector<uint8_t> readFile(const std::string& path, uint32_t& crc);
+    // 只读映射文件，调用方直接以视图读取内容，不复制到自有缓冲区；
+    // 压缩按顺序读取输入，映射时提示内核顺序预读。小文件的映射开销高于一次读取，改为读入。
+    // 调用方读完内容后以 MappedFile::verify 确认文件期间未被截断
+    static MappedFile mapFile(const std::string& path);
+    static void writeFile(const std::string& path, ByteView data);
+    // 边读边计算 CRC32C，不保留文件内容
+    static uint32_t checksumFile(const std::string& path);
+    // 文件修改时间，Unix 纪元起的纳秒数
+    static uint64_t modifiedTime(const std::string& path);
+    // 把文件（或目录项的增删）刷到磁盘，返回后即使断电也不会丢失
+    static void sync(const std::string& path);
 };
 
 } // namespace mrn
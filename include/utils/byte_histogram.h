@@ -0,0 +1,24 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mrn {
+
+using ByteHistogram = std::array<uint64_t, 256>;
+
+// 直方图内核：把连续字节分散到多张 32 位子表中累加，避免相邻的相同字节
+// 反复读写同一计数器造成的存储转发停顿
+enum class HistogramKernel {
+    Auto,   // 短输入逐字节计数，其余使用子表内核
+    Scalar, // 8 张子表，每次读取 8 字节
+};
+
+bool histogramKernelSupported(HistogramKernel kernel);
+const char* histogramKernelName(HistogramKernel kernel);
+
+// 统计 data 中各字节值出现的次数
+ByteHistogram byteHistogram(const uint8_t* data, size_t size, HistogramKernel kernel = HistogramKernel::Auto);
+
+} // namespace mrn
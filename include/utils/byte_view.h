@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace mrn {
+
+// 只读字节区间，不持有数据；调用方保证底层缓冲（vector 或内存映射）在使用期间有效
+class ByteView {
+public:
+    ByteView() = default;
+    ByteView(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    // 允许由 vector 隐式构造，接受视图的接口可以直接传入已有缓冲
+    ByteView(const std::vector<uint8_t>& data) : data_(data.data()), size_(data.size()) {}
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const uint8_t* begin() const { return data_; }
+    const uint8_t* end() const { return data_ + size_; }
+    uint8_t operator[](size_t index) const { return data_[index]; }
+
+    // 子区间，越界时抛出异常
+    ByteView subview(size_t offset, size_t size) const {
+        if (offset > size_ || size > size_ - offset) {
+            throw std::out_of_range("ByteView: subview out of range");
+        }
+        return ByteView(data_ + offset, size);
+    }
+
+    std::vector<uint8_t> toVector() const { return std::vector<uint8_t>(begin(), end()); }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace mrn
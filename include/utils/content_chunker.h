@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "utils/sha256.h"
+
+namespace mrn {
+
+// 块内容的 SHA-256 摘要，用于跨文件识别重复块。去重只比较摘要不核对字节，
+// 因此必须抗碰撞：构造出摘要相同而内容不同的块在计算上不可行
+struct ChunkDigest {
+    Sha256Digest bytes{};
+
+    bool operator==(const ChunkDigest& other) const {
+        return bytes == other.bytes;
+    }
+};
+
+struct ChunkDigestHash {
+    size_t operator()(const ChunkDigest& digest) const {
+        // 摘要本身已均匀分布，取前 8 字节即可
+        size_t value;
+        std::memcpy(&value, digest.bytes.data(), sizeof(value));
+        return value;
+    }
+};
+
+ChunkDigest digestChunk(const uint8_t* data, size_t size);
+
+// FastCDC 内容定义分块：gear 滚动哈希配合归一化掩码，
+// 插入或删除字节只影响附近的块边界，近似重复的文件仍能共享大部分块。
+class ContentChunker {
+public:
+    static constexpr size_t kMinChunkSize = 16 * 1024;
+    static constexpr size_t kAverageChunkSize = 64 * 1024;
+    static constexpr size_t kMaxChunkSize = 256 * 1024;
+
+    // 返回 data 中第一个块的长度
+    static size_t nextBoundary(const uint8_t* data, size_t size);
+
+    // 返回各块的结束位置（最后一项等于 size）
+    static std::vector<size_t> split(const uint8_t* data, size_t size);
+};
+
+} // namespace mrn
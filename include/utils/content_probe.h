@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mrn {
+
+// 由文件头魔数识别出的内容类别
+enum class ContentKind {
+    Unknown,
+    Compressed, // 压缩包、压缩过的音视频与图片：再压缩几乎没有收益
+    Document,   // PDF 等内部分段压缩的文档
+    Executable, // ELF / PE / Mach-O
+    Database,
+};
+
+// 按内容抽样探测压缩潜力：文件头、中部、尾部各取一段
+struct ContentProbe {
+    ContentKind kind = ContentKind::Unknown;
+    double entropy = 0;    // 样本的零阶熵（比特/字节）
+    bool text = false;     // 样本中没有 NUL，控制字符极少
+    size_t sampleSize = 0;
+};
+
+class ContentProber {
+public:
+    static constexpr size_t kSampleSize = 4 * 1024;
+    // 样本熵超过该值时视为已压缩或随机数据
+    static constexpr double kIncompressibleEntropy = 7.9;
+
+    static ContentKind sniffMagic(const uint8_t* data, size_t size);
+    static double entropy(const uint8_t* data, size_t size);
+    static bool looksLikeText(const uint8_t* data, size_t size);
+
+    // 读取失败时返回空探测结果（kind 为 Unknown，sampleSize 为 0）
+    static ContentProbe probeFile(const std::string& path);
+    static ContentProbe probe(const std::vector<uint8_t>& head, const std::vector<uint8_t>& sample);
+};
+
+} // namespace mrn
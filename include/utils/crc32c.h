@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mrn {
+
+// CRC32C（Castagnoli 多项式 0x1EDC6F41）。crc 为前一段的结果时可分段累计，
+// 与一次计算整段相同；支持 SSE4.2 时使用 crc32 指令，否则为 slicing-by-8 查表
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+// 由两段各自的 CRC32C 得到拼接后的 CRC32C，length2 为第二段长度
+uint32_t crc32cCombine(uint32_t crc1, uint32_t crc2, uint64_t length2);
+
+} // namespace mrn
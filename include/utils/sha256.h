@@ -0,0 +1,14 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mrn {
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+// SHA-256（FIPS 180-4）。抗碰撞，摘要相同即可视为内容相同
+Sha256Digest sha256(const uint8_t* data, size_t size);
+
+} // namespace mrn
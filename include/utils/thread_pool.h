@@ -18,6 +18,8 @@ public:
     template <typename F, typename... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<decltype(f(args...))>;
 
+    size_t size() const { return workers_.size(); }
+
 private:
     void workerLoop();
 
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "core/plugin_manager.h"
+
+using namespace mrn;
+
+// BCJ（分支转换）预处理器：把机器码中的相对调用/跳转目标改写为绝对地址，
+// 使同一函数的多处调用变成相同字节串，便于 LZ 匹配。算法与 xz 的 x86、ARM64 过滤器一致。
+namespace {
+
+enum class BcjArch : uint8_t {
+    None = 0,
+    X86 = 1,
+    Arm64 = 2,
+};
+
+uint32_t readLe32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+void writeLe32(uint8_t* p, uint32_t value) {
+    std::memcpy(p, &value, sizeof(value));
+}
+
+uint16_t readLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// 返回 [pos, limit) 中第一个 E8/E9 字节的位置，没有则返回 limit
+size_t findX86Opcode(const uint8_t* data, size_t pos, size_t limit) {
+#if defined(__SSE2__)
+    const __m128i call = _mm_set1_epi8(static_cast<char>(0xE8));
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFE));
+    for (; pos + 16 <= limit; pos += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, mask), call));
+        if (hits != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(hits)));
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t call = vdupq_n_u8(0xE8);
+    const uint8x16_t mask = vdupq_n_u8(0xFE);
+    for (; pos + 16 <= limit; pos += 16) {
+        const uint8x16_t hits = vceqq_u8(vandq_u8(vld1q_u8(data + pos), mask), call);
+        if (vmaxvq_u8(hits) != 0) {
+            break;
+        }
+    }
+#endif
+    while (pos < limit && (data[pos] & 0xFE) != 0xE8) {
+        ++pos;
+    }
+    return pos;
+}
+
+bool isX86MsByte(uint8_t b) {
+    return b == 0x00 || b == 0xFF;
+}
+
+void filterX86(uint8_t* data, size_t size, bool encode) {
+    static const bool kMaskToAllowed[8] = {true, true, true, false, true, false, false, false};
+    static const uint32_t kMaskToBitNumber[8] = {0, 1, 2, 2, 3, 3, 3, 3};
+    if (size < 5) {
+        return;
+    }
+
+    uint32_t prevMask = 0;
+    size_t prevPos = static_cast<size_t>(0) - 1;
+    const size_t limit = size - 4;
+    size_t pos = 0;
+    while ((pos = findX86Opcode(data, pos, limit)) < limit) {
+        const size_t distance = pos - prevPos;
+        prevPos = pos;
+        if (distance > 5) {
+            prevMask = 0;
+        } else {
+            for (size_t i = 0; i < distance; ++i) {
+                prevMask &= 0x77;
+                prevMask <<= 1;
+            }
+        }
+
+        uint8_t b = data[pos + 4];
+        if (!isX86MsByte(b) || !kMaskToAllowed[(prevMask >> 1) & 0x7] || (prevMask >> 1) >= 0x10) {
+            ++pos;
+            prevMask |= 1;
+            if (isX86MsByte(b)) {
+                prevMask |= 0x10;
+            }
+            continue;
+        }
+
+        uint32_t source = readLe32(data + pos + 1);
+        uint32_t target;
+        const auto ip = static_cast<uint32_t>(pos + 5);
+        while (true) {
+            target = encode ? source + ip : source - ip;
+            if (prevMask == 0) {
+                break;
+            }
+            const uint32_t shift = kMaskToBitNumber[prevMask >> 1] * 8;
+            b = static_cast<uint8_t>(target >> (24 - shift));
+            if (!isX86MsByte(b)) {
+                break;
+            }
+            source = target ^ ((1u << (32 - shift)) - 1);
+        }
+        // 只保留 25 位有效地址，最高字节由第 24 位符号扩展，逆变换据此识别
+        const uint32_t high = (target >> 24) & 1 ? 0xFF000000u : 0u;
+        target = (target & 0x00FFFFFFu) | high;
+        writeLe32(data + pos + 1, target);
+        pos += 5;
+        prevMask = 0;
+    }
+}
+
+// 返回 [pos, limit) 中第一个 BL/ADRP 指令字的位置（4 字节对齐），没有则返回 limit
+size_t findArm64Branch(const uint8_t* data, size_t pos, size_t limit) {
+#if defined(__SSE2__)
+    const __m128i blMask = _mm_set1_epi32(static_cast<int>(0xFC000000u));
+    const __m128i blValue = _mm_set1_epi32(static_cast<int>(0x94000000u));
+    const __m128i adrpMask = _mm_set1_epi32(static_cast<int>(0x9F000000u));
+    const __m128i adrpValue = _mm_set1_epi32(static_cast<int>(0x90000000u));
+    for (; pos + 16 <= limit; pos += 16) {
+        const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const __m128i hits = _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(words, blMask), blValue),
+                                          _mm_cmpeq_epi32(_mm_and_si128(words, adrpMask), adrpValue));
+        const int lanes = _mm_movemask_ps(_mm_castsi128_ps(hits));
+        if (lanes != 0) {
+            return pos + 4 * static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(lanes)));
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint32x4_t blMask = vdupq_n_u32(0xFC000000u);
+    const uint32x4_t blValue = vdupq_n_u32(0x94000000u);
+    const uint32x4_t adrpMask = vdupq_n_u32(0x9F000000u);
+    const uint32x4_t adrpValue = vdupq_n_u32(0x90000000u);
+    for (; pos + 16 <= limit; pos += 16) {
+        const uint32x4_t words = vreinterpretq_u32_u8(vld1q_u8(data + pos));
+        const uint32x4_t hits = vorrq_u32(vceqq_u32(vandq_u32(words, blMask), blValue),
+                                          vceqq_u32(vandq_u32(words, adrpMask), adrpValue));
+        if (vmaxvq_u32(hits) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; pos + 4 <= limit; pos += 4) {
+        const uint32_t word = readLe32(data + pos);
+        if ((word & 0xFC000000u) == 0x94000000u || (word & 0x9F000000u) == 0x90000000u) {
+            return pos;
+        }
+    }
+    return limit;
+}
+
+void filterArm64(uint8_t* data, size_t size, bool encode) {
+    const size_t limit = size & ~static_cast<size_t>(3);
+    for (size_t pos = 0; (pos = findArm64Branch(data, pos, limit)) < limit; pos += 4) {
+        uint32_t word = readLe32(data + pos);
+        auto pc = static_cast<uint32_t>(pos);
+        if ((word >> 26) == 0x25) {
+            // BL：26 位字偏移
+            pc >>= 2;
+            if (!encode) {
+                pc = 0u - pc;
+            }
+            word = 0x94000000u | ((word + pc) & 0x03FFFFFFu);
+        } else {
+            // ADRP：21 位页偏移，只转换 ±512 MiB 内的目标，保证可逆
+            const uint32_t source = ((word >> 29) & 3) | ((word >> 3) & 0x001FFFFCu);
+            if ((source + 0x00020000u) & 0x001C0000u) {
+                continue;
+            }
+            pc >>= 12;
+            if (!encode) {
+                pc = 0u - pc;
+            }
+            const uint32_t target = source + pc;
+            word &= 0x9000001Fu;
+            word |= (target & 3) << 29;
+            word |= (target & 0x0003FFFCu) << 3;
+            word |= (0u - (target & 0x00020000u)) & 0x00E00000u;
+        }
+        writeLe32(data + pos, word);
+    }
+}
+
+void applyFilter(BcjArch arch, uint8_t* data, size_t size, bool encode) {
+    switch (arch) {
+        case BcjArch::X86:
+            filterX86(data, size, encode);
+            break;
+        case BcjArch::Arm64:
+            filterArm64(data, size, encode);
+            break;
+        case BcjArch::None:
+            break;
+    }
+}
+
+// 根据 ELF / PE / Mach-O 头部识别目标架构
+BcjArch detectArch(ByteView data) {
+    const uint8_t* p = data.data();
+    const size_t size = data.size();
+    if (size >= 20 && std::memcmp(p, "\x7f" "ELF", 4) == 0 && p[5] == 1) {
+        switch (readLe16(p + 18)) {
+            case 3:   // EM_386
+            case 62:  // EM_X86_64
+                return BcjArch::X86;
+            case 183: // EM_AARCH64
+                return BcjArch::Arm64;
+            default:
+                return BcjArch::None;
+        }
+    }
+    if (size >= 0x40 && p[0] == 'M' && p[1] == 'Z') {
+        const uint32_t peOffset = readLe32(p + 0x3C);
+        if (peOffset <= size - 6 && std::memcmp(p + peOffset, "PE\0\0", 4) == 0) {
+            switch (readLe16(p + peOffset + 4)) {
+                case 0x014C: // i386
+                case 0x8664: // AMD64
+                    return BcjArch::X86;
+                case 0xAA64: // ARM64
+                    return BcjArch::Arm64;
+                default:
+                    return BcjArch::None;
+            }
+        }
+    }
+    if (size >= 8 && readLe32(p) == 0xFEEDFACFu) {
+        switch (readLe32(p + 4)) {
+            case 0x01000007u: // CPU_TYPE_X86_64
+                return BcjArch::X86;
+            case 0x0100000Cu: // CPU_TYPE_ARM64
+                return BcjArch::Arm64;
+            default:
+                return BcjArch::None;
+        }
+    }
+    return BcjArch::None;
+}
+
+// 固定架构的过滤器
+class BcjPreprocessor : public IPreprocessor {
+public:
+    BcjPreprocessor(BcjArch arch, uint32_t id) : arch_(arch), id_(id) {}
+
+    uint32_t getPreprocessorId() const override { return id_; }
+
+    std::vector<uint8_t> process(const std::vector<uint8_t>& data) override {
+        std::vector<uint8_t> output;
+        processInto(data, output);
+        return output;
+    }
+
+    std::vector<uint8_t> inverseProcess(const std::vector<uint8_t>& data) override {
+        std::vector<uint8_t> output;
+        inverseProcessInto(data, output);
+        return output;
+    }
+
+    void processInto(ByteView input, std::vector<uint8_t>& output) override {
+        output.assign(input.begin(), input.end());
+        applyFilter(arch_, output.data(), output.size(), true);
+    }
+
+    void inverseProcessInto(ByteView input, std::vector<uint8_t>& output) override {
+        output.assign(input.begin(), input.end());
+        applyFilter(arch_, output.data(), output.size(), false);
+    }
+
+private:
+    BcjArch arch_;
+    uint32_t id_;
+};
+
+// 按文件头自动选择架构，首字节记录所用过滤器；无法识别时原样输出
+class AutoBcjPreprocessor : public IPreprocessor {
+public:
+    uint32_t getPreprocessorId() const override { return 0x424A; } // "BJ"
+
+    std::vector<uint8_t> process(const std::vector<uint8_t>& data) override {
+        std::vector<uint8_t> output;
+        processInto(data, output);
+        return output;
+    }
+
+    std::vector<uint8_t> inverseProcess(const std::vector<uint8_t>& data) override {
+        std::vector<uint8_t> output;
+        inverseProcessInto(data, output);
+        return output;
+    }
+
+    void processInto(ByteView input, std::vector<uint8_t>& output) override {
+        const BcjArch arch = detectArch(input);
+        output.resize(input.size() + 1);
+        output[0] = static_cast<uint8_t>(arch);
+        std::copy(input.begin(), input.end(), output.begin() + 1);
+        applyFilter(arch, output.data() + 1, input.size(), true);
+    }
+
+    void inverseProcessInto(ByteView input, std::vector<uint8_t>& output) override {
+        if (input.empty() || input[0] > static_cast<uint8_t>(BcjArch::Arm64)) {
+            throw std::runtime_error("BCJ: invalid filter header");
+        }
+        output.assign(input.begin() + 1, input.end());
+        applyFilter(static_cast<BcjArch>(input[0]), output.data(), output.size(), false);
+    }
+};
+
+} // namespace
+
+static struct BcjPluginLoader {
+    BcjPluginLoader() {
+        auto& manager = PluginManager::getInstance();
+        manager.registerPreprocessor("bcj", std::make_unique<AutoBcjPreprocessor>());
+        manager.registerPreprocessor("bcj-x86", std::make_unique<BcjPreprocessor>(BcjArch::X86, 0x4238));     // "B8"
+        manager.registerPreprocessor("bcj-arm64", std::make_unique<BcjPreprocessor>(BcjArch::Arm64, 0x4241)); // "BA"
+    }
+} bcjPluginLoader;
@@ -6,6 +6,9 @@ using namespace mrn;
 
 class StubPreprocessor : public IPreprocessor {
 public:
+    uint32_t getPreprocessorId() const override {
+        return 0x5354; // "ST"
+    }
     std::vector<uint8_t> process(const std::vector<uint8_t>& data) override {
         return data;
     }
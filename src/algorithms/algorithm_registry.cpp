@@ -2,6 +2,12 @@
 #include "algorithms/move_optimizer.h"
 #include "algorithms/lz77_compressor.h"
 #include "algorithms/huffman_encoder.h"
+#include "algorithms/entropy_coder.h"
+#include "core/archive_format.h"
+#include "utils/varint.h"
+
+#include <algorithm>
+#include <stdexcept>
 
 namespace mrn {
 
@@ -19,6 +25,178 @@ namespace mrn {
         static ClassName##Registrar ClassName##_registrar; \
     }
 
+namespace {
+// MoveRun 负载首字节：最高位置 1 表示分块熵编码格式；旧格式首字节为 Huffman 模式（< 0x80）
+constexpr uint8_t kPayloadEntropyFramed = 0x80;
+// 分块熵编码格式的低位记录实际执行的阶段；全为 0 时为 zlib deflate 数据
+constexpr uint8_t kPayloadNativeLz = 0x01;
+constexpr uint8_t kPayloadMoveOptimized = 0x02;
+// LZ 窗口以归档的共享字典预热
+constexpr uint8_t kPayloadDictionary = 0x04;
+// 流式负载：之后为一串独立压缩的帧，
+// 每帧 [varint 原始大小][u8 类型][varint 负载大小][负载]，原始大小为 0 的帧表示结束
+constexpr uint8_t kPayloadStreamed = 0x08;
+constexpr uint8_t kFrameStored = 0;
+constexpr uint8_t kFrameCompressed = 1;
+// 流式帧大小：覆盖 LZ 窗口与最大的块排序块，又足够小以保持内存占用恒定
+constexpr size_t kStreamFrameSize = 4 * 1024 * 1024;
+// 允许提前放弃时，不小于 kProbeMinInput 的输入先逐个压缩开头的 kProbeFrames 个探测帧
+constexpr size_t kProbeFrameSize = 256 * 1024;
+constexpr size_t kProbeFrames = 2;
+constexpr size_t kProbeMinInput = 4 * kProbeFrameSize;
+
+// 过短的令牌流不足以摊销码表开销，直接原样存储
+constexpr size_t kMinEntropyStreamSize = 64;
+
+// 由压缩级别规划各阶段：低级别省去代价估算，高级别以块排序变换代替 LZ
+struct MoveRunPlan {
+    int lzLevel = 6;
+    bool moveOptimizer = false;
+    bool compareTransforms = false; // 两种变换都试，保留较小者
+    size_t blockSize = MoveOptimizer::kDefaultBlockSize;
+    EntropyBackend backend = EntropyBackend::Auto;
+};
+
+std::string configValue(const AlgorithmConfig& config, const std::string& key, const std::string& fallback) {
+    auto it = config.values.find(key);
+    return it != config.values.end() ? it->second : fallback;
+}
+
+// 解析块大小，支持 k/m 后缀（如 "900k"）
+size_t parseBlockSize(const std::string& text) {
+    size_t consumed = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &consumed);
+    } catch (const std::exception&) {
+        throw std::runtime_error("MoveRunCompressor: invalid block size: " + text);
+    }
+    const std::string suffix = text.substr(consumed);
+    if (suffix == "k" || suffix == "K") {
+        value <<= 10;
+    } else if (suffix == "m" || suffix == "M") {
+        value <<= 20;
+    } else if (!suffix.empty()) {
+        throw std::runtime_error("MoveRunCompressor: invalid block size: " + text);
+    }
+    return static_cast<size_t>(value);
+}
+
+void validateTransform(const std::string& transform) {
+    if (transform != "auto" && transform != "bwt" && transform != "lz") {
+        throw std::runtime_error("MoveRunCompressor: unknown transform: " + transform);
+    }
+}
+
+MoveRunPlan planStages(const CompressParams& params, const std::string& defaultBackend) {
+    MoveRunPlan plan;
+    plan.lzLevel = std::min(std::max(params.level, LZ77Compressor::kMinLevel), LZ77Compressor::kMaxLevel);
+
+    const auto transform = configValue(params.config, "transform", "auto");
+    validateTransform(transform);
+    plan.moveOptimizer = transform == "bwt" || (transform == "auto" && plan.lzLevel >= 7);
+    // 最高级别的 LZ 使用最优解析，在结构化数据上可能胜过块排序变换，值得把两条路径都跑一遍
+    plan.compareTransforms = transform == "auto" && plan.lzLevel >= LZ77Compressor::kMaxLevel;
+    // 字典只对 LZ 有意义，且上层只为小文件提供字典，此时块排序变换本就不占优
+    if (params.dictionary && !params.dictionary->empty()) {
+        plan.moveOptimizer = false;
+        plan.compareTransforms = false;
+    }
+    // 与 bzip2 相同，级别 n 对应 n × 100 KiB 的块
+    const auto block = configValue(params.config, "block", "");
+    plan.blockSize = block.empty() ? static_cast<size_t>(plan.lzLevel) * 100 * 1024 : parseBlockSize(block);
+    plan.backend = plan.lzLevel <= 2 ? EntropyBackend::Huffman : EntropyBackend::Auto;
+    const auto override = configValue(params.config, "entropy", defaultBackend);
+    if (!override.empty() && override != "auto") {
+        plan.backend = EntropyCoder::parseBackend(override);
+    }
+    return plan;
+}
+
+void appendStream(std::vector<uint8_t>& out, const std::vector<uint8_t>& encoded) {
+    writeVarint(out, encoded.size());
+    out.insert(out.end(), encoded.begin(), encoded.end());
+}
+
+std::vector<uint8_t> readStream(const EntropyCoder& coder, ByteView in, size_t& pos) {
+    const uint64_t size = readVarint(in.data(), in.size(), pos);
+    if (size > in.size() - pos) {
+        throw std::runtime_error("MoveRunCompressor: truncated token stream");
+    }
+    auto decoded = coder.decode(in.data() + pos, size);
+    pos += size;
+    return decoded;
+}
+
+// 解码结果追加到调用方的缓冲区；缓冲区为空时直接接管，不复制
+void appendDecoded(std::vector<uint8_t>& output, std::vector<uint8_t>&& decoded) {
+    if (output.empty()) {
+        output = std::move(decoded);
+    } else {
+        output.insert(output.end(), decoded.begin(), decoded.end());
+    }
+}
+
+// 写出一帧；无收益的帧原样存储，与整文件压缩的退化策略一致
+void appendFrame(std::vector<uint8_t>& output, ByteView raw, const CompressionResult& frame, uint8_t& stages) {
+    writeVarint(output, raw.size());
+    if (frame.compressedData.size() >= raw.size()) {
+        output.push_back(kFrameStored);
+        writeVarint(output, raw.size());
+        output.insert(output.end(), raw.begin(), raw.end());
+    } else {
+        output.push_back(kFrameCompressed);
+        writeVarint(output, frame.compressedData.size());
+        output.insert(output.end(), frame.compressedData.begin(), frame.compressedData.end());
+        stages |= frame.stages;
+    }
+}
+} // namespace
+
+class MoveRunCompressor;
+
+// MoveRun 流式会话：输入攒满一帧即调用 compress 独立压缩并写出，帧间不共享上下文
+class MoveRunStream : public ICompressionStream {
+public:
+    MoveRunStream(MoveRunCompressor& owner, const CompressParams& params) : owner_(owner), params_(params) {
+        buffer_.reserve(kStreamFrameSize);
+    }
+
+    void feed(const uint8_t* data, size_t size, std::vector<uint8_t>& output) override {
+        while (size > 0) {
+            const size_t take = std::min(size, kStreamFrameSize - buffer_.size());
+            buffer_.insert(buffer_.end(), data, data + take);
+            data += take;
+            size -= take;
+            if (buffer_.size() == kStreamFrameSize) {
+                flushFrame(output);
+            }
+        }
+    }
+
+    CompressionResult finish(std::vector<uint8_t>& output) override {
+        if (!buffer_.empty()) {
+            flushFrame(output);
+        }
+        writeVarint(output, 0);
+        CompressionResult result;
+        result.uncompressedSize = totalSize_;
+        result.isCompressed = true;
+        result.stages = stages_;
+        return result;
+    }
+
+private:
+    void flushFrame(std::vector<uint8_t>& output);
+
+    MoveRunCompressor& owner_;
+    CompressParams params_;
+    std::vector<uint8_t> buffer_;
+    CompressionResult frame_; // 各帧复用的压缩输出缓冲区
+    uint64_t totalSize_ = 0;
+    uint8_t stages_ = 0;
+};
+
 class MoveRunCompressor : public ICompressionAlgorithm {
 public:
     static std::string getStaticName() { return "moverun"; }
@@ -27,44 +205,245 @@ public:
     std::string getVersion() const override { return "2.0"; }
     uint32_t getAlgorithmId() const override { return 0x4D52; }
 
-    CompressionResult compress(const CompressParams& params,
-                               const std::vector<uint8_t>& data) override {
-        auto moved = moveOptimizer_.optimize(data, params.mode);
-        auto lzBlock = lz77_.compress(moved.data);
-        CompressionResult result;
-        result.compressedData = huffman_.encode(lzBlock.buffer);
-        result.uncompressedSize = data.size();
-        result.isCompressed = lzBlock.isCompressed;
-        return result;
+    void compressInto(const CompressParams& params, ByteView data, CompressionResult& result) override {
+        if (params.incompressibleRatio > 0.0 && data.size() >= kProbeMinInput) {
+            compressProbed(params, data, result);
+            return;
+        }
+        MoveRunPlan plan = planStages(params, entropyBackend_);
+        if (!plan.compareTransforms) {
+            compressWithPlan(plan, params, data, result);
+            return;
+        }
+        // 块排序结果直接写入调用方的缓冲区，LZ 结果更小时再替换
+        const size_t start = result.compressedData.size();
+        plan.moveOptimizer = true;
+        compressWithPlan(plan, params, data, result);
+        plan.moveOptimizer = false;
+        CompressionResult parsed;
+        compressWithPlan(plan, params, data, parsed);
+        if (parsed.compressedData.size() < result.compressedData.size() - start) {
+            result.compressedData.resize(start);
+            result.compressedData.insert(result.compressedData.end(), parsed.compressedData.begin(),
+                                         parsed.compressedData.end());
+            result.stages = parsed.stages;
+        }
     }
 
-    DecompressionResult decompress(const DecompressParams& params,
-                                   const std::vector<uint8_t>& data) override {
-        auto decoded = huffman_.decode(data);
-        auto decompressed = lz77_.decompress(decoded, params.expectedSize, params.dataIsCompressed);
-        DecompressionResult result;
-        result.decompressedData = decompressed;
-        return result;
+    void decompressInto(const DecompressParams& params, ByteView data, std::vector<uint8_t>& output) override {
+        // 压缩无收益时上层直接存储原始数据，不经过任何阶段
+        if (!params.dataIsCompressed) {
+            if (data.size() != params.expectedSize) {
+                throw std::runtime_error("MoveRunCompressor: stored payload size mismatch");
+            }
+            output.insert(output.end(), data.begin(), data.end());
+            return;
+        }
+
+        const uint8_t lead = data.empty() ? 0 : data[0];
+        if (lead == (kPayloadEntropyFramed | kPayloadStreamed)) {
+            decompressFrames(params, data, output);
+            return;
+        }
+        if ((lead & kPayloadEntropyFramed) && (lead & (kPayloadNativeLz | kPayloadMoveOptimized))) {
+            std::vector<uint8_t> restored;
+            if (lead & kPayloadNativeLz) {
+                size_t pos = 1;
+                LZ77Streams streams;
+                streams.originalSize = readVarint(data.data(), data.size(), pos);
+                streams.sequenceCount = readVarint(data.data(), data.size(), pos);
+                if (!(lead & kPayloadMoveOptimized) && streams.originalSize != params.expectedSize) {
+                    throw std::runtime_error("MoveRunCompressor: size mismatch");
+                }
+                streams.literals = readStream(entropyCoder_, data, pos);
+                streams.lengths = readStream(entropyCoder_, data, pos);
+                streams.offsets = readStream(entropyCoder_, data, pos);
+                if (lead & kPayloadDictionary) {
+                    if (!params.dictionary || params.dictionary->empty()) {
+                        throw std::runtime_error("MoveRunCompressor: payload requires a shared dictionary");
+                    }
+                    restored = lz77_.decompressStreams(streams, params.dictionary->data(), params.dictionary->size());
+                } else {
+                    restored = lz77_.decompressStreams(streams);
+                }
+            } else {
+                restored = entropyCoder_.decode(data.data() + 1, data.size() - 1);
+            }
+            if (lead & kPayloadMoveOptimized) {
+                restored = moveOptimizer_.restore(restored.data(), restored.size());
+            }
+            if (restored.size() != params.expectedSize) {
+                throw std::runtime_error("MoveRunCompressor: size mismatch");
+            }
+            appendDecoded(output, std::move(restored));
+            return;
+        }
+
+        // 旧格式：zlib deflate 外再包一层 Huffman 或分块熵编码
+        std::vector<uint8_t> decoded;
+        if (!data.empty() && (data[0] & kPayloadEntropyFramed)) {
+            decoded = entropyCoder_.decode(data.data() + 1, data.size() - 1);
+        } else {
+            decoded = huffman_.decode(data.data(), data.size());
+        }
+        appendDecoded(output, lz77_.decompress(decoded, params.expectedSize, params.dataIsCompressed));
     }
 
     AlgorithmCapabilities getCapabilities() const override {
         AlgorithmCapabilities caps;
         caps.supportsMultithreading = true;
-        caps.supportsStreaming = false;
+        caps.supportsStreaming = true;
         caps.maxWindowSize = 1 << 20;
         return caps;
     }
 
+    std::unique_ptr<ICompressionStream> beginStream(const CompressParams& params,
+                                                    std::vector<uint8_t>& output) override {
+        planStages(params, entropyBackend_); // 提前校验参数
+        output.push_back(kPayloadEntropyFramed | kPayloadStreamed);
+        return std::make_unique<MoveRunStream>(*this, params);
+    }
+
     void configure(const AlgorithmConfig& config) override {
-        (void)config;
+        const auto backend = configValue(config, "entropy", entropyBackend_);
+        EntropyCoder::parseBackend(backend);
+        validateTransform(configValue(config, "transform", "auto"));
+        entropyBackend_ = backend;
     }
 
 private:
+    // 开头逐帧试压，试压的结果直接作为负载的前几帧；有一帧压得动就把其余数据作为一帧整体压缩，
+    // 开头 kProbeFrames 帧都压不动时放弃，不再压缩其余数据
+    void compressProbed(const CompressParams& params, ByteView data, CompressionResult& result) {
+        auto& out = result.compressedData;
+        const size_t start = out.size();
+        out.push_back(kPayloadEntropyFramed | kPayloadStreamed);
+
+        CompressParams frameParams = params;
+        frameParams.incompressibleRatio = 0.0;
+        CompressionResult frame;
+        uint8_t stages = 0;
+        size_t offset = 0;
+        bool compressible = false;
+        for (size_t probe = 0; probe < kProbeFrames && !compressible; ++probe) {
+            const auto piece = data.subview(offset, kProbeFrameSize);
+            frame.compressedData.clear();
+            compressInto(frameParams, piece, frame);
+            compressible = static_cast<double>(frame.compressedData.size()) <
+                           static_cast<double>(piece.size()) * params.incompressibleRatio;
+            appendFrame(out, piece, frame, stages);
+            offset += piece.size();
+        }
+
+        result.uncompressedSize = data.size();
+        if (!compressible) {
+            out.resize(start);
+            result.isCompressed = false;
+            result.stages = 0;
+            return;
+        }
+        frame.compressedData.clear();
+        const auto rest = data.subview(offset, data.size() - offset);
+        compressInto(frameParams, rest, frame);
+        appendFrame(out, rest, frame, stages);
+        writeVarint(out, 0);
+        result.isCompressed = true;
+        result.stages = stages;
+    }
+
+    void compressWithPlan(const MoveRunPlan& plan, const CompressParams& params, ByteView data,
+                          CompressionResult& result) {
+        auto& out = result.compressedData;
+        const size_t start = out.size();
+        out.push_back(kPayloadEntropyFramed | kPayloadNativeLz);
+
+        result.uncompressedSize = data.size();
+        result.isCompressed = true;
+        result.stages = 0;
+
+        // 块排序变换后的 MTF/零游程符号直接熵编码，再叠加 LZ 没有收益
+        if (plan.moveOptimizer) {
+            auto moved = moveOptimizer_.optimize(data.data(), data.size(), "bwt", plan.blockSize);
+            out[start] = kPayloadEntropyFramed | kPayloadMoveOptimized;
+            auto encoded = entropyCoder_.encode(moved.data.data(), moved.data.size(), plan.backend);
+            out.insert(out.end(), encoded.begin(), encoded.end());
+            result.stages = MRN_FILE_FLAG_STAGE_MOVE | MRN_FILE_FLAG_STAGE_ENTROPY;
+            return;
+        }
+
+        const auto* dictionary = params.dictionary && !params.dictionary->empty() ? params.dictionary : nullptr;
+        auto streams = dictionary
+                           ? lz77_.compressStreams(data.data(), data.size(), plan.lzLevel,
+                                                   dictionary->data(), dictionary->size())
+                           : lz77_.compressStreams(data.data(), data.size(), plan.lzLevel);
+        result.stages |= MRN_FILE_FLAG_STAGE_LZ;
+        if (dictionary) {
+            out[start] |= kPayloadDictionary;
+            result.stages |= MRN_FILE_FLAG_DICTIONARY;
+        }
+
+        // 三条令牌流分别熵编码，避免字面量与长度、偏移的统计混在同一张表里
+        writeVarint(out, streams.originalSize);
+        writeVarint(out, streams.sequenceCount);
+        for (const auto* stream : {&streams.literals, &streams.lengths, &streams.offsets}) {
+            const auto backend = stream->size() < kMinEntropyStreamSize ? EntropyBackend::Raw : plan.backend;
+            if (backend != EntropyBackend::Raw) {
+                result.stages |= MRN_FILE_FLAG_STAGE_ENTROPY;
+            }
+            appendStream(out, entropyCoder_.encode(stream->data(), stream->size(), backend));
+        }
+    }
+
+    // 各帧直接解码到 output 末尾，帧负载以视图传入，不另行复制
+    void decompressFrames(const DecompressParams& params, ByteView data, std::vector<uint8_t>& output) {
+        const size_t start = output.size();
+        output.reserve(start + params.expectedSize);
+        size_t pos = 1;
+        while (true) {
+            const uint64_t frameSize = readVarint(data.data(), data.size(), pos);
+            if (frameSize == 0) {
+                break;
+            }
+            if (pos >= data.size()) {
+                throw std::runtime_error("MoveRunCompressor: truncated stream frame");
+            }
+            const uint8_t kind = data[pos++];
+            const uint64_t payloadSize = readVarint(data.data(), data.size(), pos);
+            const uint64_t restored = output.size() - start;
+            if (payloadSize > data.size() - pos || frameSize > params.expectedSize - restored) {
+                throw std::runtime_error("MoveRunCompressor: stream frame out of range");
+            }
+            const auto payload = data.subview(pos, payloadSize);
+            pos += payloadSize;
+
+            DecompressParams frameParams = params;
+            frameParams.expectedSize = frameSize;
+            frameParams.dataIsCompressed = kind == kFrameCompressed;
+            if (kind != kFrameStored && kind != kFrameCompressed) {
+                throw std::runtime_error("MoveRunCompressor: unknown stream frame type");
+            }
+            decompressInto(frameParams, payload, output);
+        }
+        if (pos != data.size() || output.size() - start != params.expectedSize) {
+            throw std::runtime_error("MoveRunCompressor: size mismatch");
+        }
+    }
+
     MoveOptimizer moveOptimizer_;
     LZ77Compressor lz77_;
-    HuffmanEncoder huffman_;
+    HuffmanEncoder huffman_; // 仅用于解码旧格式负载
+    EntropyCoder entropyCoder_;
+    std::string entropyBackend_ = "auto"; // 默认熵编码后端，可被 CompressParams::config 覆盖
 };
 
+void MoveRunStream::flushFrame(std::vector<uint8_t>& output) {
+    frame_.compressedData.clear();
+    owner_.compressInto(params_, buffer_, frame_);
+    appendFrame(output, buffer_, frame_, stages_);
+    totalSize_ += buffer_.size();
+    buffer_.clear();
+}
+
 // 注册MoveRun算法
 REGISTER_ALGORITHM(MoveRunCompressor);
 
@@ -0,0 +1,111 @@
+#include "algorithms/dictionary_trainer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mrn {
+
+namespace {
+constexpr size_t kDmerSize = 8;
+constexpr unsigned kFrequencyLog = 20;
+
+size_t dmerHash(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return static_cast<size_t>((value * 0xCF1BBCDCB7A56463ull) >> (64 - kFrequencyLog));
+}
+
+struct Segment {
+    size_t begin = 0;
+    size_t end = 0; // 最后一个片段的起点（含）之后一位
+    uint64_t score = 0;
+};
+} // namespace
+
+std::vector<uint8_t> DictionaryTrainer::train(const std::vector<uint8_t>& samples,
+                                              const std::vector<size_t>& sampleSizes,
+                                              size_t dictionarySize) {
+    std::vector<uint8_t> dictionary;
+    if (samples.size() < kSegmentSize || dictionarySize == 0) {
+        return dictionary;
+    }
+
+    // 片段出现次数；不跨越样本边界计数
+    std::vector<uint32_t> frequency(size_t(1) << kFrequencyLog, 0);
+    size_t sampleBegin = 0;
+    for (size_t sampleSize : sampleSizes) {
+        const size_t sampleEnd = std::min(sampleBegin + sampleSize, samples.size());
+        for (size_t pos = sampleBegin; pos + kDmerSize <= sampleEnd; ++pos) {
+            frequency[dmerHash(samples.data() + pos)]++;
+        }
+        sampleBegin = sampleEnd;
+    }
+
+    // 样本切成若干轮，每轮选出一段
+    const size_t dmerCount = samples.size() - kDmerSize + 1;
+    const size_t windowDmers = kSegmentSize - kDmerSize + 1;
+    const size_t epochs = std::max<size_t>(1, std::min(dictionarySize / kSegmentSize, dmerCount / kSegmentSize));
+    const size_t epochSize = dmerCount / epochs;
+
+    std::vector<uint16_t> segmentFrequency(frequency.size(), 0);
+    std::vector<Segment> selected;
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        const size_t epochBegin = epoch * epochSize;
+        const size_t epochEnd = epoch + 1 == epochs ? dmerCount : epochBegin + epochSize;
+
+        // 滑动窗口内每种片段只计一次分
+        Segment best;
+        Segment active{epochBegin, epochBegin, 0};
+        while (active.end < epochEnd) {
+            const size_t added = dmerHash(samples.data() + active.end);
+            if (segmentFrequency[added]++ == 0) {
+                active.score += frequency[added];
+            }
+            active.end++;
+            if (active.end - active.begin == windowDmers) {
+                if (active.score > best.score) {
+                    best = active;
+                }
+                const size_t removed = dmerHash(samples.data() + active.begin);
+                if (--segmentFrequency[removed] == 0) {
+                    active.score -= frequency[removed];
+                }
+                active.begin++;
+            }
+        }
+        for (size_t pos = active.begin; pos < active.end; ++pos) {
+            segmentFrequency[dmerHash(samples.data() + pos)]--;
+        }
+
+        if (best.score == 0) {
+            continue;
+        }
+        // 已入选的片段不再计分，后续轮次转向其他内容
+        for (size_t pos = best.begin; pos < best.end; ++pos) {
+            frequency[dmerHash(samples.data() + pos)] = 0;
+        }
+        selected.push_back(best);
+    }
+
+    // 高分段优先入选，写入时倒序排列：低分段在前、高分段在后
+    std::stable_sort(selected.begin(), selected.end(),
+                     [](const Segment& a, const Segment& b) { return a.score > b.score; });
+    std::vector<Segment> chosen;
+    size_t total = 0;
+    for (const auto& segment : selected) {
+        const size_t length = segment.end - segment.begin + kDmerSize - 1;
+        if (total + length <= dictionarySize) {
+            chosen.push_back(segment);
+            total += length;
+        }
+    }
+    dictionary.reserve(total);
+    for (auto it = chosen.rbegin(); it != chosen.rend(); ++it) {
+        const size_t length = it->end - it->begin + kDmerSize - 1;
+        dictionary.insert(dictionary.end(), samples.begin() + static_cast<std::ptrdiff_t>(it->begin),
+                          samples.begin() + static_cast<std::ptrdiff_t>(it->begin + length));
+    }
+    return dictionary;
+}
+
+} // namespace mrn
@@ -0,0 +1,149 @@
+#include "algorithms/entropy_coder.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "utils/byte_histogram.h"
+#include "utils/varint.h"
+
+namespace mrn {
+
+namespace {
+// 块标记
+constexpr uint8_t kBlockRaw = 0;
+constexpr uint8_t kBlockHuffman = 1;
+constexpr uint8_t kBlockTans = 2;
+
+void appendBlock(std::vector<uint8_t>& out, uint8_t tag, const uint8_t* data, size_t size) {
+    out.push_back(tag);
+    writeVarint(out, size);
+    out.insert(out.end(), data, data + size);
+}
+} // namespace
+
+EntropyBackend EntropyCoder::parseBackend(const std::string& name) {
+    if (name.empty() || name == "auto") {
+        return EntropyBackend::Auto;
+    }
+    if (name == "huffman") {
+        return EntropyBackend::Huffman;
+    }
+    if (name == "tans" || name == "fse") {
+        return EntropyBackend::Tans;
+    }
+    if (name == "raw" || name == "none") {
+        return EntropyBackend::Raw;
+    }
+    throw std::runtime_error("EntropyCoder: unknown entropy backend: " + name);
+}
+
+EntropyBackend EntropyCoder::chooseBackend(const uint8_t* data, size_t size) const {
+    const ByteHistogram frequencies = byteHistogram(data, size);
+
+    int lastSymbol = 255;
+    while (lastSymbol > 0 && frequencies[lastSymbol] == 0) {
+        --lastSymbol;
+    }
+
+    // 表头大小按各编码器的实际格式估算：Huffman 为半字节码长表，tANS 为变长计数表
+    std::array<uint8_t, 256> lengths{};
+    HuffmanEncoder::buildCodeLengths(frequencies.data(), lengths.data(), HuffmanEncoder::kMaxCodeLength);
+    const uint64_t huffmanBytes = HuffmanEncoder::encodedBits(frequencies.data(), lengths.data()) / 8 +
+                                  5 + static_cast<uint64_t>(lastSymbol) / 2 + 1;
+
+    const unsigned tableLog = TansEncoder::chooseTableLog(frequencies.data(), size);
+    std::array<uint16_t, 256> normalized{};
+    TansEncoder::normalizeCounts(frequencies.data(), size, tableLog, normalized.data());
+    uint64_t tansBytes = TansEncoder::encodedBits(frequencies.data(), normalized.data(), tableLog) / 8 + 6;
+    for (int s = 0; s <= lastSymbol; ++s) {
+        tansBytes += normalized[s] < 0x80 ? 1 : 2;
+    }
+
+    if (std::min(huffmanBytes, tansBytes) >= size) {
+        return EntropyBackend::Raw;
+    }
+    return tansBytes < huffmanBytes ? EntropyBackend::Tans : EntropyBackend::Huffman;
+}
+
+std::vector<uint8_t> EntropyCoder::encode(const uint8_t* data, size_t size, EntropyBackend backend) const {
+    std::vector<uint8_t> out;
+    writeVarint(out, size);
+
+    for (size_t offset = 0; offset < size; offset += kBlockSize) {
+        const size_t blockSize = std::min(kBlockSize, size - offset);
+        const uint8_t* block = data + offset;
+
+        EntropyBackend chosen = backend;
+        if (chosen == EntropyBackend::Auto) {
+            chosen = chooseBackend(block, blockSize);
+        }
+
+        std::vector<uint8_t> encoded;
+        uint8_t tag = kBlockRaw;
+        if (chosen == EntropyBackend::Huffman) {
+            encoded = huffman_.encode(block, blockSize);
+            tag = kBlockHuffman;
+        } else if (chosen == EntropyBackend::Tans) {
+            encoded = tans_.encode(block, blockSize);
+            tag = kBlockTans;
+        }
+
+        // 编码无收益时该块原样存储
+        if (tag == kBlockRaw || encoded.size() >= blockSize) {
+            appendBlock(out, kBlockRaw, block, blockSize);
+        } else {
+            appendBlock(out, tag, encoded.data(), encoded.size());
+        }
+    }
+    return out;
+}
+
+std::vector<uint8_t> EntropyCoder::decode(const uint8_t* data, size_t size) const {
+    size_t pos = 0;
+    const uint64_t totalSize = readVarint(data, size, pos);
+    std::vector<uint8_t> out(totalSize);
+    uint64_t written = 0;
+
+    while (pos < size) {
+        const uint8_t tag = data[pos++];
+        const uint64_t blockSize = readVarint(data, size, pos);
+        if (blockSize > size - pos) {
+            throw std::runtime_error("EntropyCoder: truncated block");
+        }
+        const uint8_t* block = data + pos;
+        pos += blockSize;
+
+        std::vector<uint8_t> decoded;
+        const uint8_t* source = block;
+        uint64_t sourceSize = blockSize;
+        if (tag == kBlockHuffman) {
+            decoded = huffman_.decode(block, blockSize);
+        } else if (tag == kBlockTans) {
+            decoded = tans_.decode(block, blockSize);
+        } else if (tag != kBlockRaw) {
+            throw std::runtime_error("EntropyCoder: unknown block tag " + std::to_string(tag));
+        }
+        if (tag != kBlockRaw) {
+            source = decoded.data();
+            sourceSize = decoded.size();
+        }
+
+        if (sourceSize > totalSize - written) {
+            throw std::runtime_error("EntropyCoder: block exceeds declared size");
+        }
+        if (sourceSize > 0) {
+            std::memcpy(out.data() + written, source, sourceSize);
+        }
+        written += sourceSize;
+    }
+
+    if (written != totalSize) {
+        throw std::runtime_error("EntropyCoder: size mismatch");
+    }
+    return out;
+}
+
+} // namespace mrn
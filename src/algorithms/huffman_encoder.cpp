@@ -1,229 +1,408 @@
 #include "algorithms/huffman_encoder.h"
 
-#include <bitset>
-#include <cstring>
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <stdexcept>
+#include <string>
+
+#include "algorithms/bit_stream.h"
+#include "utils/byte_histogram.h"
+#include "utils/varint.h"
 
 namespace mrn {
 
-std::vector<uint8_t> HuffmanEncoder::encode(const std::vector<uint8_t>& data) const {
-    if (data.empty()) {
-        return {};
-    }
-    
-    // 如果数据太小，直接返回（Huffman对小数据可能反而增大）
-    if (data.size() < 16) {
-        std::vector<uint8_t> result;
-        result.push_back(0); // 标记：未压缩
-        result.insert(result.end(), data.begin(), data.end());
-        return result;
-    }
-    
-    // 统计频率
-    std::map<uint8_t, uint64_t> frequencies;
-    for (uint8_t byte : data) {
-        frequencies[byte]++;
-    }
-    
-    // 如果只有一种符号，直接返回
-    if (frequencies.size() == 1) {
-        std::vector<uint8_t> result;
-        result.push_back(0); // 标记：未压缩
-        result.insert(result.end(), data.begin(), data.end());
-        return result;
-    }
-    
-    // 构建Huffman树
-    HuffmanNode* root = buildTree(frequencies);
-    
-    // 构建编码表
-    std::map<uint8_t, std::vector<bool>> codes;
-    buildCodeTable(root, codes);
-    
-    // 编码数据
-    std::vector<bool> bits;
-    for (uint8_t byte : data) {
-        const auto& code = codes[byte];
-        bits.insert(bits.end(), code.begin(), code.end());
-    }
-    
-    // 转换为字节
+namespace {
+// 负载首字节标记
+constexpr uint8_t kModeRaw = 0;
+constexpr uint8_t kModeLegacyTree = 1; // 旧版：频率表 + 指针树，仅保留解码
+constexpr uint8_t kModeCanonical = 2;
+
+// 小于该长度的数据直接存储（表头开销大于收益）
+constexpr size_t kMinEncodeSize = 16;
+
+std::vector<uint8_t> storeRaw(const uint8_t* data, size_t size) {
     std::vector<uint8_t> result;
-    result.push_back(1); // 标记：已压缩
-    
-    // 写入频率表大小
-    result.push_back(static_cast<uint8_t>(frequencies.size()));
-    
-    // 写入频率表
-    for (const auto& [symbol, freq] : frequencies) {
-        result.push_back(symbol);
-        uint64_t f = freq;
-        for (int i = 0; i < 8; ++i) {
-            result.push_back(static_cast<uint8_t>(f & 0xFF));
-            f >>= 8;
+    result.reserve(size + 1);
+    result.push_back(kModeRaw);
+    result.insert(result.end(), data, data + size);
+    return result;
+}
+
+uint32_t reverseBits(uint32_t code, unsigned length) {
+    uint32_t reversed = 0;
+    for (unsigned i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+// 由码长生成规范码，并按 LSB 优先的位序翻转
+void assignCanonicalCodes(const uint8_t* lengths, uint32_t* codes) {
+    std::array<uint32_t, HuffmanEncoder::kMaxCodeLength + 2> lengthCount{};
+    for (int s = 0; s < 256; ++s) {
+        lengthCount[lengths[s]]++;
+    }
+    lengthCount[0] = 0;
+
+    std::array<uint32_t, HuffmanEncoder::kMaxCodeLength + 2> nextCode{};
+    uint32_t code = 0;
+    for (unsigned len = 1; len <= HuffmanEncoder::kMaxCodeLength; ++len) {
+        code = (code + lengthCount[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+    for (int s = 0; s < 256; ++s) {
+        const unsigned len = lengths[s];
+        codes[s] = len ? reverseBits(nextCode[len]++, len) : 0;
+    }
+}
+} // namespace
+
+void HuffmanEncoder::buildCodeLengths(const uint64_t* frequencies, uint8_t* lengths, unsigned maxLength) {
+    struct SymbolWeight {
+        uint64_t key;
+        uint16_t symbol;
+    };
+
+    std::array<SymbolWeight, 256> sorted;
+    int n = 0;
+    for (int s = 0; s < 256; ++s) {
+        lengths[s] = 0;
+        if (frequencies[s] > 0) {
+            sorted[n++] = {frequencies[s], static_cast<uint16_t>(s)};
+        }
+    }
+    if (n == 0) {
+        return;
+    }
+    if (n == 1) {
+        lengths[sorted[0].symbol] = 1;
+        return;
+    }
+
+    std::sort(sorted.begin(), sorted.begin() + n, [](const SymbolWeight& a, const SymbolWeight& b) {
+        return a.key != b.key ? a.key < b.key : a.symbol < b.symbol;
+    });
+
+    // Moffat-Katajainen 原地算法：输入按频率升序，输出每个位置的最优码长
+    auto* a = sorted.data();
+    a[0].key += a[1].key;
+    int root = 0;
+    int leaf = 2;
+    for (int next = 1; next < n - 1; ++next) {
+        if (leaf >= n || a[root].key < a[leaf].key) {
+            a[next].key = a[root].key;
+            a[root++].key = static_cast<uint64_t>(next);
+        } else {
+            a[next].key = a[leaf++].key;
+        }
+        if (leaf >= n || (root < next && a[root].key < a[leaf].key)) {
+            a[next].key += a[root].key;
+            a[root++].key = static_cast<uint64_t>(next);
+        } else {
+            a[next].key += a[leaf++].key;
+        }
+    }
+    a[n - 2].key = 0;
+    for (int next = n - 3; next >= 0; --next) {
+        a[next].key = a[a[next].key].key + 1;
+    }
+    int available = 1;
+    int used = 0;
+    uint64_t depth = 0;
+    root = n - 2;
+    int next = n - 1;
+    while (available > 0) {
+        while (root >= 0 && a[root].key == depth) {
+            ++used;
+            --root;
+        }
+        while (available > used) {
+            a[next--].key = depth;
+            --available;
         }
+        available = 2 * used;
+        ++depth;
+        used = 0;
     }
-    
-    // 写入编码后的数据长度（位）
-    uint32_t bitCount = static_cast<uint32_t>(bits.size());
-    for (int i = 0; i < 4; ++i) {
-        result.push_back(static_cast<uint8_t>(bitCount & 0xFF));
-        bitCount >>= 8;
-    }
-    
-    // 写入编码后的数据
-    uint8_t currentByte = 0;
-    int bitPos = 0;
-    for (bool bit : bits) {
-        if (bit) {
-            currentByte |= (1 << bitPos);
+
+    // 统计各码长数量，并把超长码压到 maxLength 以内（保持 Kraft 等式）
+    std::array<uint32_t, 257> lengthCount{};
+    for (int i = 0; i < n; ++i) {
+        lengthCount[a[i].key]++;
+    }
+    for (unsigned len = maxLength + 1; len < lengthCount.size(); ++len) {
+        lengthCount[maxLength] += lengthCount[len];
+        lengthCount[len] = 0;
+    }
+    uint64_t total = 0;
+    for (unsigned len = maxLength; len > 0; --len) {
+        total += static_cast<uint64_t>(lengthCount[len]) << (maxLength - len);
+    }
+    while (total != (uint64_t(1) << maxLength)) {
+        lengthCount[maxLength]--;
+        for (unsigned len = maxLength - 1; len > 0; --len) {
+            if (lengthCount[len]) {
+                lengthCount[len]--;
+                lengthCount[len + 1] += 2;
+                break;
+            }
         }
-        bitPos++;
-        if (bitPos == 8) {
-            result.push_back(currentByte);
-            currentByte = 0;
-            bitPos = 0;
+        --total;
+    }
+
+    // 频率越高的符号分配越短的码
+    int index = n;
+    for (unsigned len = 1; len <= maxLength; ++len) {
+        for (uint32_t count = lengthCount[len]; count > 0; --count) {
+            lengths[a[--index].symbol] = static_cast<uint8_t>(len);
         }
     }
-    if (bitPos > 0) {
-        result.push_back(currentByte);
+}
+
+uint64_t HuffmanEncoder::encodedBits(const uint64_t* frequencies, const uint8_t* lengths) {
+    uint64_t bits = 0;
+    for (int s = 0; s < 256; ++s) {
+        bits += frequencies[s] * lengths[s];
+    }
+    return bits;
+}
+
+std::vector<uint8_t> HuffmanEncoder::encode(const std::vector<uint8_t>& data) const {
+    return encode(data.data(), data.size());
+}
+
+std::vector<uint8_t> HuffmanEncoder::encode(const uint8_t* data, size_t size) const {
+    if (size == 0) {
+        return {};
+    }
+    if (size < kMinEncodeSize) {
+        return storeRaw(data, size);
+    }
+
+    const ByteHistogram frequencies = byteHistogram(data, size);
+
+    std::array<uint8_t, 256> lengths{};
+    buildCodeLengths(frequencies.data(), lengths.data(), kMaxCodeLength);
+
+    int lastSymbol = 255;
+    while (lengths[lastSymbol] == 0) {
+        --lastSymbol;
+    }
+
+    // 表头：模式、原始长度、最大符号、半字节码长表
+    std::vector<uint8_t> result;
+    result.push_back(kModeCanonical);
+    writeVarint(result, size);
+    result.push_back(static_cast<uint8_t>(lastSymbol));
+    for (int s = 0; s <= lastSymbol; s += 2) {
+        const uint8_t high = s + 1 <= lastSymbol ? lengths[s + 1] : 0;
+        result.push_back(static_cast<uint8_t>(lengths[s] | (high << 4)));
+    }
+
+    const uint64_t payloadBytes = (encodedBits(frequencies.data(), lengths.data()) + 7) / 8;
+    if (result.size() + payloadBytes >= size + 1) {
+        return storeRaw(data, size);
+    }
+
+    std::array<uint32_t, 256> codes{};
+    assignCanonicalCodes(lengths.data(), codes.data());
+
+    const size_t headerSize = result.size();
+    result.resize(headerSize + payloadBytes + sizeof(uint64_t));
+    BitWriter writer(result.data() + headerSize);
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        writer.write(codes[data[i]], lengths[data[i]]);
+        writer.write(codes[data[i + 1]], lengths[data[i + 1]]);
+        writer.write(codes[data[i + 2]], lengths[data[i + 2]]);
+        writer.write(codes[data[i + 3]], lengths[data[i + 3]]);
+        writer.flush();
     }
-    
-    deleteTree(root);
-    
-    // 如果压缩后反而更大，返回原始数据
-    if (result.size() >= data.size()) {
-        std::vector<uint8_t> original;
-        original.push_back(0);
-        original.insert(original.end(), data.begin(), data.end());
-        return original;
+    for (; i < size; ++i) {
+        writer.write(codes[data[i]], lengths[data[i]]);
+        writer.flush();
     }
-    
+    result.resize(headerSize + writer.finish());
     return result;
 }
 
 std::vector<uint8_t> HuffmanEncoder::decode(const std::vector<uint8_t>& data) const {
-    if (data.empty()) {
+    return decode(data.data(), data.size());
+}
+
+std::vector<uint8_t> HuffmanEncoder::decode(const uint8_t* data, size_t size) const {
+    if (size == 0) {
         return {};
     }
-    
-    size_t pos = 0;
-    uint8_t flag = data[pos++];
-    
-    if (flag == 0) {
-        // 未压缩数据
-        std::vector<uint8_t> result;
-        result.insert(result.end(), data.begin() + pos, data.end());
-        return result;
-    }
-    
-    // 读取频率表大小
-    uint8_t freqCount = data[pos++];
-    
-    // 读取频率表
-    std::map<uint8_t, uint64_t> frequencies;
-    for (uint8_t i = 0; i < freqCount && pos < data.size(); ++i) {
-        uint8_t symbol = data[pos++];
-        uint64_t freq = 0;
-        for (int j = 0; j < 8 && pos < data.size(); ++j) {
-            freq |= (static_cast<uint64_t>(data[pos++]) << (j * 8));
+
+    const uint8_t mode = data[0];
+    if (mode == kModeRaw) {
+        return std::vector<uint8_t>(data + 1, data + size);
+    }
+    if (mode == kModeLegacyTree) {
+        return decodeLegacy(data, size);
+    }
+    if (mode != kModeCanonical) {
+        throw std::runtime_error("HuffmanEncoder: unknown block mode " + std::to_string(mode));
+    }
+
+    size_t pos = 1;
+    const uint64_t symbolCount = readVarint(data, size, pos);
+    if (pos >= size) {
+        throw std::runtime_error("HuffmanEncoder: truncated header");
+    }
+    const int lastSymbol = data[pos++];
+    const size_t tableBytes = static_cast<size_t>(lastSymbol) / 2 + 1;
+    if (pos + tableBytes > size) {
+        throw std::runtime_error("HuffmanEncoder: truncated code length table");
+    }
+
+    std::array<uint8_t, 256> lengths{};
+    unsigned maxLength = 0;
+    for (int s = 0; s <= lastSymbol; ++s) {
+        const uint8_t packed = data[pos + s / 2];
+        lengths[s] = (s & 1) ? (packed >> 4) : (packed & 0x0F);
+        if (lengths[s] > kMaxCodeLength) {
+            throw std::runtime_error("HuffmanEncoder: invalid code length");
         }
-        frequencies[symbol] = freq;
+        maxLength = std::max<unsigned>(maxLength, lengths[s]);
     }
-    
-    // 读取位长度
-    uint32_t bitCount = 0;
-    for (int i = 0; i < 4 && pos < data.size(); ++i) {
-        bitCount |= (static_cast<uint32_t>(data[pos++]) << (i * 8));
-    }
-    
-    // 读取编码数据
-    std::vector<bool> bits;
-    for (uint32_t i = 0; i < bitCount && pos < data.size(); ++i) {
-        uint8_t byte = data[pos++];
-        for (int j = 0; j < 8 && (i * 8 + j) < bitCount; ++j) {
-            bits.push_back((byte >> j) & 1);
+    pos += tableBytes;
+    if (maxLength == 0) {
+        throw std::runtime_error("HuffmanEncoder: empty code table");
+    }
+
+    uint64_t kraft = 0;
+    for (int s = 0; s <= lastSymbol; ++s) {
+        if (lengths[s]) {
+            kraft += uint64_t(1) << (maxLength - lengths[s]);
         }
     }
-    
-    // 重建Huffman树
-    HuffmanNode* root = buildTree(frequencies);
-    
-    // 解码
-    std::vector<uint8_t> result;
-    HuffmanNode* current = root;
-    for (bool bit : bits) {
-        if (bit) {
-            current = current->right;
-        } else {
-            current = current->left;
+    if (kraft > (uint64_t(1) << maxLength)) {
+        throw std::runtime_error("HuffmanEncoder: oversubscribed code table");
+    }
+
+    // 单级查表：以 maxLength 位为索引，表项为 (符号 << 4) | 码长，码长 0 表示非法码
+    std::array<uint32_t, 256> codes{};
+    assignCanonicalCodes(lengths.data(), codes.data());
+    std::vector<uint16_t> table(size_t(1) << maxLength, 0);
+    for (int s = 0; s <= lastSymbol; ++s) {
+        const unsigned len = lengths[s];
+        if (len == 0) {
+            continue;
         }
-        
-        if (current->isLeaf()) {
-            result.push_back(current->symbol);
-            current = root;
+        const uint16_t entry = static_cast<uint16_t>((s << 4) | len);
+        for (size_t fill = codes[s]; fill < table.size(); fill += size_t(1) << len) {
+            table[fill] = entry;
         }
     }
-    
-    deleteTree(root);
+
+    std::vector<uint8_t> result(symbolCount);
+    uint8_t* out = result.data();
+    BitReader reader(data + pos, size - pos);
+
+    // 非法码的码长为 0，不消耗位；循环结束后统一检查，避免热循环内分支
+    bool invalid = false;
+    auto decodeOne = [&](size_t index) {
+        const uint16_t entry = table[reader.peek(maxLength)];
+        const unsigned len = entry & 0x0F;
+        invalid |= len == 0;
+        reader.consume(len);
+        out[index] = static_cast<uint8_t>(entry >> 4);
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= symbolCount; i += 4) {
+        reader.refill();
+        decodeOne(i);
+        decodeOne(i + 1);
+        decodeOne(i + 2);
+        decodeOne(i + 3);
+    }
+    for (; i < symbolCount; ++i) {
+        reader.refill();
+        decodeOne(i);
+    }
+    if (invalid) {
+        throw std::runtime_error("HuffmanEncoder: invalid code in bitstream");
+    }
+    if (reader.overrun()) {
+        throw std::runtime_error("HuffmanEncoder: truncated bitstream");
+    }
     return result;
 }
 
-HuffmanNode* HuffmanEncoder::buildTree(const std::map<uint8_t, uint64_t>& frequencies) const {
-    std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, NodeCompare> pq;
-    
-    // 创建叶子节点
-    for (const auto& [symbol, freq] : frequencies) {
-        auto* node = new HuffmanNode;
-        node->symbol = symbol;
-        node->frequency = freq;
-        pq.push(node);
-    }
-    
-    // 构建树
-    while (pq.size() > 1) {
-        auto* left = pq.top();
-        pq.pop();
-        auto* right = pq.top();
-        pq.pop();
-        
-        auto* parent = new HuffmanNode;
-        parent->frequency = left->frequency + right->frequency;
-        parent->left = left;
-        parent->right = right;
-        pq.push(parent);
-    }
-    
-    return pq.empty() ? nullptr : pq.top();
-}
+std::vector<uint8_t> HuffmanEncoder::decodeLegacy(const uint8_t* data, size_t size) const {
+    // 旧格式：[1][符号数][符号 + 8 字节频率]...[位数 u32][位流]
+    struct Node {
+        uint64_t frequency = 0;
+        int left = -1;
+        int right = -1;
+        uint8_t symbol = 0;
+    };
 
-void HuffmanEncoder::buildCodeTable(HuffmanNode* root, std::map<uint8_t, std::vector<bool>>& codes,
-                                   std::vector<bool> code) const {
-    if (root == nullptr) {
-        return;
+    size_t pos = 1;
+    if (pos >= size) {
+        throw std::runtime_error("HuffmanEncoder: truncated legacy header");
     }
-    
-    if (root->isLeaf()) {
-        codes[root->symbol] = code;
-        return;
+    const uint8_t freqCount = data[pos++];
+
+    std::vector<Node> nodes;
+    nodes.reserve(512);
+    for (uint8_t i = 0; i < freqCount && pos < size; ++i) {
+        Node leaf;
+        leaf.symbol = data[pos++];
+        for (int j = 0; j < 8 && pos < size; ++j) {
+            leaf.frequency |= static_cast<uint64_t>(data[pos++]) << (j * 8);
+        }
+        nodes.push_back(leaf);
     }
-    
-    std::vector<bool> leftCode = code;
-    leftCode.push_back(false);
-    buildCodeTable(root->left, codes, leftCode);
-    
-    std::vector<bool> rightCode = code;
-    rightCode.push_back(true);
-    buildCodeTable(root->right, codes, rightCode);
-}
 
-void HuffmanEncoder::deleteTree(HuffmanNode* node) const {
-    if (node == nullptr) {
-        return;
+    uint32_t bitCount = 0;
+    for (int i = 0; i < 4 && pos < size; ++i) {
+        bitCount |= static_cast<uint32_t>(data[pos++]) << (i * 8);
+    }
+
+    // 与旧编码器完全相同的建树顺序，保证树形一致
+    auto compare = [&nodes](int a, int b) { return nodes[a].frequency > nodes[b].frequency; };
+    std::priority_queue<int, std::vector<int>, decltype(compare)> queue(compare);
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+        queue.push(i);
+    }
+    while (queue.size() > 1) {
+        const int left = queue.top();
+        queue.pop();
+        const int right = queue.top();
+        queue.pop();
+        Node parent;
+        parent.frequency = nodes[left].frequency + nodes[right].frequency;
+        parent.left = left;
+        parent.right = right;
+        nodes.push_back(parent);
+        queue.push(static_cast<int>(nodes.size()) - 1);
     }
-    deleteTree(node->left);
-    deleteTree(node->right);
-    delete node;
+    if (queue.empty()) {
+        return {};
+    }
+
+    const int root = queue.top();
+    std::vector<uint8_t> result;
+    int current = root;
+    for (uint32_t bit = 0; bit < bitCount && pos + bit / 8 < size; ++bit) {
+        const bool set = (data[pos + bit / 8] >> (bit % 8)) & 1;
+        current = set ? nodes[current].right : nodes[current].left;
+        if (current < 0) {
+            throw std::runtime_error("HuffmanEncoder: corrupt legacy bitstream");
+        }
+        if (nodes[current].left < 0 && nodes[current].right < 0) {
+            result.push_back(nodes[current].symbol);
+            current = root;
+        }
+    }
+    return result;
 }
 
 } // namespace mrn
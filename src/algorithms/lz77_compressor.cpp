@@ -1,47 +1,514 @@
 #include "algorithms/lz77_compressor.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <cstring>
 #include <stdexcept>
 #include <string>
 #include <zlib.h>
 
+#include "utils/byte_histogram.h"
+#include "utils/varint.h"
+
 namespace mrn {
 
 namespace {
-constexpr int kCompressionLevel = Z_BEST_COMPRESSION;
+// 匹配位置以 32 位存放，超长输入按段独立解析
+constexpr size_t kSegmentSize = size_t(1) << 30;
+
+// 各级别参数：窗口、哈希表、搜索深度、惰性深度、满意长度、查找器类型、稀疏入表、最优解析轮数
+const LZLevelParams kLevelTable[] = {
+    {17, 14, 1, 0, 16, false, true},    // 1
+    {17, 15, 4, 0, 24, false, false},   // 2
+    {18, 16, 8, 1, 32, false, false},   // 3
+    {18, 16, 16, 1, 48, false, false},  // 4
+    {19, 17, 32, 1, 64, false, false},  // 5
+    {20, 17, 64, 2, 96, false, false},  // 6
+    {20, 18, 48, 2, 96, true, false},   // 7
+    {20, 18, 96, 2, 160, true, false, 2},  // 8
+    {20, 18, 256, 2, 273, true, false, 4}, // 9
+};
+
+// 最优解析每个窗口覆盖的位置数；窗口末端之后只接受窗口内匹配延伸到的位置
+constexpr size_t kOptimalWindow = 4096;
+// 代价以 1/256 比特为单位
+constexpr double kPriceScale = 256.0;
+
+uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
 }
 
-LZ77CompressedBlock LZ77Compressor::compress(const std::vector<uint8_t>& data) const {
-    LZ77CompressedBlock block;
-    const uint64_t originalSize = data.size();
-    if (originalSize == 0) {
-        block.isCompressed = false;
-        return block;
+unsigned highBit(uint32_t value) {
+    return 31 - static_cast<unsigned>(__builtin_clz(value));
+}
+
+void writeLength(std::vector<uint8_t>& out, uint64_t value) {
+    if (value < 255) {
+        out.push_back(static_cast<uint8_t>(value));
+        return;
     }
+    out.push_back(255);
+    writeVarint(out, value - 255);
+}
 
-    uLongf destinationSize = compressBound(static_cast<uLong>(originalSize));
-    block.buffer.resize(destinationSize);
+uint64_t readLength(const std::vector<uint8_t>& in, size_t& pos) {
+    if (pos >= in.size()) {
+        throw std::runtime_error("LZ77Compressor: truncated length stream");
+    }
+    const uint8_t value = in[pos++];
+    if (value < 255) {
+        return value;
+    }
+    return 255 + readVarint(in.data(), in.size(), pos);
+}
 
-    int result = ::compress2(
-        block.buffer.data(),
-        &destinationSize,
-        data.data(),
-        static_cast<uLong>(originalSize),
-        kCompressionLevel);
+// 收集序列并写入三条令牌流；rep0 为上一个偏移，跨段保持与解码器一致
+class SequenceWriter {
+public:
+    explicit SequenceWriter(LZ77Streams& streams) : streams_(streams) {}
+
+    uint32_t rep0() const { return rep0_; }
 
-    if (result != Z_OK) {
-        throw std::runtime_error("LZ77Compressor: compress2 failed with code " + std::to_string(result));
+    void emit(const uint8_t* literals, size_t literalLength, size_t matchLength, uint32_t offset) {
+        streams_.literals.insert(streams_.literals.end(), literals, literals + literalLength);
+        writeLength(streams_.lengths, literalLength);
+        writeLength(streams_.lengths, matchLength - kLZMinMatch);
+        offsetCodes_.push_back(offset == rep0_ ? 0 : offset);
+        rep0_ = offset;
+        streams_.sequenceCount++;
     }
 
-    if (destinationSize >= originalSize) {
-        block.isCompressed = false;
-        block.buffer.assign(data.begin(), data.end());
-        return block;
+    void appendLiterals(const uint8_t* literals, size_t length) {
+        streams_.literals.insert(streams_.literals.end(), literals, literals + length);
     }
 
-    block.isCompressed = true;
-    block.buffer.resize(destinationSize);
-    return block;
+    void finish() {
+        const size_t count = offsetCodes_.size();
+        streams_.offsets.resize(count * 3);
+        for (size_t i = 0; i < count; ++i) {
+            streams_.offsets[i] = static_cast<uint8_t>(offsetCodes_[i]);
+            streams_.offsets[count + i] = static_cast<uint8_t>(offsetCodes_[i] >> 8);
+            streams_.offsets[2 * count + i] = static_cast<uint8_t>(offsetCodes_[i] >> 16);
+        }
+    }
+
+private:
+    LZ77Streams& streams_;
+    std::vector<uint32_t> offsetCodes_;
+    uint32_t rep0_ = 0;
+};
+
+struct Candidate {
+    uint32_t length = 0;
+    uint32_t offset = 0;
+    int gain = 0;
+};
+
+// 收益估算：每字节匹配约值 4 个单位，偏移越远编码代价越高；重复偏移几乎免费
+int matchGain(uint32_t length, uint32_t offset, bool repeat) {
+    return static_cast<int>(length * 4) - (repeat ? 1 : static_cast<int>(highBit(offset)) + 1);
+}
+
+// 令牌流各符号的代价（1/256 比特），由上一轮解析结果的符号频率得出。
+// 字面量与长度流整体统计；偏移流按字节平面分别统计，与其存放方式一致
+class PriceModel {
+public:
+    explicit PriceModel(const LZ77Streams& streams) {
+        fill(literal_, streams.literals.data(), streams.literals.size());
+        fill(length_, streams.lengths.data(), streams.lengths.size());
+        const size_t count = streams.offsets.size() / 3;
+        for (size_t plane = 0; plane < 3; ++plane) {
+            fill(offset_[plane], streams.offsets.data() + plane * count, count);
+        }
+    }
+
+    uint32_t literal(uint8_t byte) const { return literal_[byte]; }
+
+    // writeLength 写出的长度码
+    uint32_t length(uint64_t value) const {
+        if (value < 255) {
+            return length_[value];
+        }
+        uint32_t price = length_[255];
+        for (value -= 255; value >= 0x80; value >>= 7) {
+            price += static_cast<uint32_t>(8 * kPriceScale);
+        }
+        return price + static_cast<uint32_t>(8 * kPriceScale);
+    }
+
+    // 偏移码：与上一偏移相同时写 0
+    uint32_t offset(uint32_t code) const {
+        return offset_[0][code & 0xFF] + offset_[1][(code >> 8) & 0xFF] + offset_[2][(code >> 16) & 0xFF];
+    }
+
+private:
+    uint32_t literal_[256];
+    uint32_t length_[256];
+    uint32_t offset_[3][256];
+
+    // 未出现的符号按半次计，避免代价无穷大
+    static void fill(uint32_t* prices, const uint8_t* data, size_t size) {
+        const ByteHistogram counts = byteHistogram(data, size);
+        const double total = static_cast<double>(size) + 128.0;
+        for (int symbol = 0; symbol < 256; ++symbol) {
+            const double probability = (static_cast<double>(counts[symbol]) + 0.5) / total;
+            prices[symbol] = static_cast<uint32_t>(-std::log2(probability) * kPriceScale + 0.5);
+        }
+    }
+};
+
+// 按零阶熵估算令牌流编码后的比特数，用于在各轮解析结果中取最优
+double estimateBits(const LZ77Streams& streams) {
+    auto entropy = [](const uint8_t* data, size_t size) {
+        double bits = 0;
+        for (uint64_t count : byteHistogram(data, size)) {
+            if (count > 0) {
+                bits += static_cast<double>(count) * std::log2(static_cast<double>(size) / static_cast<double>(count));
+            }
+        }
+        return bits;
+    };
+    const size_t count = streams.offsets.size() / 3;
+    double bits = entropy(streams.literals.data(), streams.literals.size()) +
+                  entropy(streams.lengths.data(), streams.lengths.size());
+    for (size_t plane = 0; plane < 3; ++plane) {
+        bits += entropy(streams.offsets.data() + plane * count, count);
+    }
+    return bits;
+}
+
+// 最优解析的节点：到达该位置的最小代价（含当前字面量串的长度码）与回溯信息
+struct OptimalNode {
+    int64_t cost = 0;
+    uint32_t literalLength = 0; // 到达该位置时尚未结束的字面量串长度
+    uint32_t rep0 = 0;          // 该路径上最后一个偏移
+    uint32_t matchLength = 0;   // 0 表示由字面量到达
+    uint32_t offset = 0;
+};
+
+// 价格驱动的最优解析：窗口内对每个位置的所有匹配长度做前向动态规划，
+// 字面量、长度、偏移的代价来自 PriceModel；遇到不短于 niceLength 的匹配直接采用
+template <typename Finder>
+void parseSegmentOptimal(const uint8_t* data, size_t size, size_t start, const LZLevelParams& params,
+                         const PriceModel& prices, SequenceWriter& writer) {
+    Finder finder(data, size, params);
+    LZMatch matches[kLZMaxMatchesPerPosition];
+    constexpr int64_t kInfinity = INT64_MAX / 2;
+    std::vector<OptimalNode> nodes(kOptimalWindow + params.niceLength + 1);
+
+    size_t base = start;
+    size_t literalStart = start;
+    while (base + kLZMinMatch <= size) {
+        const size_t window = std::min(kOptimalWindow, size - base);
+        size_t reach = window;
+        const uint32_t pendingLiterals = static_cast<uint32_t>(base - literalStart);
+        nodes[0] = {static_cast<int64_t>(prices.length(pendingLiterals)), pendingLiterals, writer.rep0(), 0, 0};
+        for (size_t i = 1; i < nodes.size(); ++i) {
+            nodes[i].cost = kInfinity;
+        }
+
+        auto relax = [&](size_t from, size_t to, uint32_t length, uint32_t offset) {
+            const OptimalNode& node = nodes[from];
+            const uint32_t code = offset == node.rep0 ? 0 : offset;
+            const int64_t cost = node.cost + prices.length(length - kLZMinMatch) + prices.offset(code) +
+                                 prices.length(0);
+            if (cost < nodes[to].cost) {
+                nodes[to] = {cost, 0, offset, length, offset};
+            }
+        };
+
+        size_t stop = 0;
+        LZMatch commit{};
+        for (size_t r = 0; r < reach; ++r) {
+            const size_t pos = base + r;
+            const OptimalNode& node = nodes[r];
+
+            // 字面量
+            const int64_t literalCost = node.cost + prices.literal(data[pos]) +
+                                        prices.length(node.literalLength + 1) - prices.length(node.literalLength);
+            if (literalCost < nodes[r + 1].cost) {
+                nodes[r + 1] = {literalCost, node.literalLength + 1, node.rep0, 0, 0};
+            }
+            if (pos + kLZMinMatch > size) {
+                continue;
+            }
+
+            // 窗口末端之后的位置不再把 reach 向后推
+            const size_t maxLength = r < window ? nodes.size() - 1 - r : reach - r;
+            const size_t count = finder.findMatches(pos, matches);
+            uint32_t repLength = 0;
+            const uint32_t rep = node.rep0;
+            if (rep != 0 && pos >= rep && read32(data + pos) == read32(data + pos - rep)) {
+                repLength = static_cast<uint32_t>(lzCommonLength(data + pos - rep, data + pos, size - pos));
+            }
+            const uint32_t longest = count > 0 ? matches[count - 1].length : 0;
+            if (r < window && std::max(longest, repLength) >= params.niceLength) {
+                commit = repLength >= longest ? LZMatch{repLength, rep} : matches[count - 1];
+                stop = r;
+                break;
+            }
+
+            if (repLength >= kLZMinMatch) {
+                const auto limit = static_cast<uint32_t>(std::min<size_t>(repLength, maxLength));
+                for (uint32_t length = kLZMinMatch; length <= limit; ++length) {
+                    relax(r, r + length, length, rep);
+                }
+            }
+            uint32_t previous = kLZMinMatch - 1;
+            for (size_t i = 0; i < count; ++i) {
+                const auto limit = static_cast<uint32_t>(std::min<size_t>(matches[i].length, maxLength));
+                for (uint32_t length = previous + 1; length <= limit; ++length) {
+                    relax(r, r + length, length, matches[i].offset);
+                }
+                previous = std::max(previous, limit);
+            }
+            if (r < window) {
+                reach = std::max<size_t>(reach, r + previous);
+                reach = std::max<size_t>(reach, r + std::min<size_t>(repLength, maxLength));
+            }
+        }
+        if (commit.length == 0) {
+            stop = reach;
+        }
+
+        // 回溯出最优路径，再按顺序写出序列
+        std::vector<size_t> path;
+        for (size_t r = stop; r > 0;) {
+            path.push_back(r);
+            r -= nodes[r].matchLength > 0 ? nodes[r].matchLength : 1;
+        }
+        size_t pos = base;
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            const OptimalNode& node = nodes[*it];
+            if (node.matchLength == 0) {
+                ++pos;
+                continue;
+            }
+            pos = base + *it - node.matchLength;
+            writer.emit(data + literalStart, pos - literalStart, node.matchLength, node.offset);
+            pos += node.matchLength;
+            literalStart = pos;
+        }
+        base += stop;
+
+        if (commit.length > 0) {
+            // 二叉树查找的长度受 niceLength 截断，这里补全
+            commit.length += static_cast<uint32_t>(lzCommonLength(data + base - commit.offset + commit.length,
+                                                                  data + base + commit.length,
+                                                                  size - base - commit.length));
+            writer.emit(data + literalStart, base - literalStart, commit.length, commit.offset);
+            base += commit.length;
+            literalStart = base;
+        }
+    }
+    writer.appendLiterals(data + literalStart, size - literalStart);
+}
+
+// [0, start) 为字典前缀，只入表不输出
+template <typename Finder>
+void parseSegment(const uint8_t* data, size_t size, size_t start,
+                  const LZLevelParams& params, SequenceWriter& writer) {
+    Finder finder(data, size, params);
+    LZMatch matches[kLZMaxMatchesPerPosition];
+
+    auto bestAt = [&](size_t pos, Candidate& best) {
+        best = Candidate{};
+        const size_t count = finder.findMatches(pos, matches);
+        if (count > 0) {
+            const LZMatch& longest = matches[count - 1];
+            best = {longest.length, longest.offset,
+                    matchGain(longest.length, longest.offset, longest.offset == writer.rep0())};
+        }
+        const uint32_t rep = writer.rep0();
+        if (rep != 0 && pos >= rep && read32(data + pos) == read32(data + pos - rep)) {
+            const auto length = static_cast<uint32_t>(lzCommonLength(data + pos - rep, data + pos, size - pos));
+            const int gain = matchGain(length, rep, true);
+            if (gain > best.gain) {
+                best = {length, rep, gain};
+            }
+        }
+        return best.length >= kLZMinMatch;
+    };
+
+    size_t pos = start;
+    size_t literalStart = start;
+    size_t misses = 0;
+    while (pos + kLZMinMatch <= size) {
+        Candidate best;
+        if (!bestAt(pos, best)) {
+            // 最快级别在连续未命中时加大步长，快速跳过不可压缩区域
+            if (params.sparseInsert) {
+                pos += 1 + (misses++ >> 5);
+                finder.advance(pos);
+            } else {
+                ++pos;
+            }
+            continue;
+        }
+        misses = 0;
+
+        for (unsigned step = 0; step < params.lazyDepth && pos + 1 + kLZMinMatch <= size; ++step) {
+            Candidate next;
+            if (bestAt(pos + 1, next) && next.gain > best.gain + 4) {
+                best = next;
+                ++pos;
+            } else {
+                break;
+            }
+        }
+
+        // 二叉树查找的长度受 niceLength 截断，这里补全；再向前回收与匹配相同的字面量
+        best.length += static_cast<uint32_t>(lzCommonLength(data + pos - best.offset + best.length,
+                                                            data + pos + best.length,
+                                                            size - pos - best.length));
+        while (pos > literalStart && pos > best.offset && data[pos - 1] == data[pos - 1 - best.offset]) {
+            --pos;
+            ++best.length;
+        }
+
+        writer.emit(data + literalStart, pos - literalStart, best.length, best.offset);
+        pos += best.length;
+        literalStart = pos;
+        if (params.sparseInsert) {
+            finder.advance(pos);
+        }
+    }
+    writer.appendLiterals(data + literalStart, size - literalStart);
+}
+} // namespace
+
+LZLevelParams LZ77Compressor::levelParams(int level) {
+    level = std::min(std::max(level, kMinLevel), kMaxLevel);
+    return kLevelTable[level - 1];
+}
+
+LZ77Streams LZ77Compressor::compressStreams(const uint8_t* data, size_t size, int level,
+                                            const uint8_t* dictionary, size_t dictionarySize) const {
+    const LZLevelParams params = levelParams(level);
+
+    // 字典只用于小输入：与数据拼接后作为一个段解析
+    std::vector<uint8_t> window;
+    if (dictionarySize > 0) {
+        if (size + dictionarySize > kSegmentSize) {
+            throw std::runtime_error("LZ77Compressor: input too large for dictionary mode");
+        }
+        window.assign(dictionary, dictionary + dictionarySize);
+        window.insert(window.end(), data, data + size);
+    }
+
+    auto parse = [&](const PriceModel* prices) {
+        LZ77Streams streams;
+        streams.originalSize = size;
+        SequenceWriter writer(streams);
+        auto parseRange = [&](const uint8_t* input, size_t inputSize, size_t start) {
+            if (prices && params.binaryTree) {
+                parseSegmentOptimal<BinaryTreeMatchFinder>(input, inputSize, start, params, *prices, writer);
+            } else if (prices) {
+                parseSegmentOptimal<HashChainMatchFinder>(input, inputSize, start, params, *prices, writer);
+            } else if (params.binaryTree) {
+                parseSegment<BinaryTreeMatchFinder>(input, inputSize, start, params, writer);
+            } else {
+                parseSegment<HashChainMatchFinder>(input, inputSize, start, params, writer);
+            }
+        };
+        if (dictionarySize > 0) {
+            parseRange(window.data(), window.size(), dictionarySize);
+        } else {
+            for (size_t offset = 0; offset < size; offset += kSegmentSize) {
+                parseRange(data + offset, std::min(kSegmentSize, size - offset), 0);
+            }
+        }
+        writer.finish();
+        return streams;
+    };
+
+    LZ77Streams best = parse(nullptr);
+    if (params.optimalPasses == 0) {
+        return best;
+    }
+
+    // 代价模型从惰性解析的统计出发，每轮以上一轮结果重新统计；估算不再下降时停止
+    double bestBits = estimateBits(best);
+    PriceModel prices(best);
+    for (unsigned pass = 0; pass < params.optimalPasses; ++pass) {
+        LZ77Streams candidate = parse(&prices);
+        const double bits = estimateBits(candidate);
+        if (bits >= bestBits) {
+            break;
+        }
+        prices = PriceModel(candidate);
+        best = std::move(candidate);
+        bestBits = bits;
+    }
+    return best;
+}
+
+std::vector<uint8_t> LZ77Compressor::decompressStreams(const LZ77Streams& streams,
+                                                       const uint8_t* dictionary,
+                                                       size_t dictionarySize) const {
+    const uint64_t sequenceCount = streams.sequenceCount;
+    if (streams.offsets.size() != sequenceCount * 3) {
+        throw std::runtime_error("LZ77Compressor: offset stream size mismatch");
+    }
+
+    // 字典放在输出之前，匹配可以直接回溯到字典中
+    std::vector<uint8_t> output(dictionarySize + streams.originalSize);
+    if (dictionarySize > 0) {
+        std::memcpy(output.data(), dictionary, dictionarySize);
+    }
+    uint8_t* out = output.data() + dictionarySize;
+    const uint64_t outSize = streams.originalSize;
+    uint64_t written = 0;
+    size_t literalPos = 0;
+    size_t lengthPos = 0;
+    uint64_t rep0 = 0;
+
+    for (uint64_t i = 0; i < sequenceCount; ++i) {
+        const uint64_t literalLength = readLength(streams.lengths, lengthPos);
+        const uint64_t matchLength = readLength(streams.lengths, lengthPos) + kLZMinMatch;
+        uint64_t offset = streams.offsets[i] |
+                          (static_cast<uint64_t>(streams.offsets[sequenceCount + i]) << 8) |
+                          (static_cast<uint64_t>(streams.offsets[2 * sequenceCount + i]) << 16);
+        if (offset == 0) {
+            offset = rep0;
+        }
+        rep0 = offset;
+
+        if (literalLength > streams.literals.size() - literalPos ||
+            literalLength > outSize - written) {
+            throw std::runtime_error("LZ77Compressor: literal run out of range");
+        }
+        std::memcpy(out + written, streams.literals.data() + literalPos, literalLength);
+        literalPos += literalLength;
+        written += literalLength;
+
+        if (offset == 0 || offset > written + dictionarySize || matchLength > outSize - written) {
+            throw std::runtime_error("LZ77Compressor: match out of range");
+        }
+        uint8_t* dst = out + written;
+        const uint8_t* src = dst - offset;
+        if (offset >= matchLength) {
+            std::memcpy(dst, src, matchLength);
+        } else {
+            for (uint64_t k = 0; k < matchLength; ++k) {
+                dst[k] = src[k];
+            }
+        }
+        written += matchLength;
+    }
+
+    const uint64_t trailing = streams.literals.size() - literalPos;
+    if (trailing != outSize - written) {
+        throw std::runtime_error("LZ77Compressor: size mismatch");
+    }
+    std::memcpy(out + written, streams.literals.data() + literalPos, trailing);
+    if (dictionarySize > 0) {
+        output.erase(output.begin(), output.begin() + static_cast<std::ptrdiff_t>(dictionarySize));
+    }
+    return output;
 }
 
 std::vector<uint8_t> LZ77Compressor::decompress(const std::vector<uint8_t>& data,
@@ -51,8 +518,8 @@ std::vector<uint8_t> LZ77Compressor::decompress(const std::vector<uint8_t>& data
         if (data.size() != expectedSize) {
             throw std::runtime_error("LZ77Compressor: raw payload size mismatch");
         }
-    return data;
-}
+        return data;
+    }
 
     std::vector<uint8_t> output(expectedSize);
     if (expectedSize == 0) {
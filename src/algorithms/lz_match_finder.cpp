@@ -0,0 +1,204 @@
+#include "algorithms/lz_match_finder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mrn {
+
+namespace {
+constexpr uint32_t kEmpty = 0; // 表中存放 位置 + 1，0 表示空
+
+uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash4(const uint8_t* p, unsigned hashLog) {
+    return (read32(p) * 2654435761u) >> (32 - hashLog);
+}
+
+unsigned ceilLog2(size_t value) {
+    unsigned log = 0;
+    while ((size_t(1) << log) < value) {
+        ++log;
+    }
+    return log;
+}
+
+// 小输入时按实际大小缩小窗口与哈希表，避免为小文件清零数 MB 的表
+void fitTables(size_t size, LZLevelParams& params) {
+    const unsigned sizeLog = std::max(8u, ceilLog2(size));
+    params.windowLog = std::min(params.windowLog, sizeLog);
+    params.hashLog = std::min(params.hashLog, sizeLog + 1);
+}
+} // namespace
+
+size_t lzCommonLength(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t length = 0;
+    while (length + sizeof(uint64_t) <= limit) {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + length, sizeof(x));
+        std::memcpy(&y, b + length, sizeof(y));
+        const uint64_t diff = x ^ y;
+        if (diff != 0) {
+            return length + (static_cast<unsigned>(__builtin_ctzll(diff)) >> 3);
+        }
+        length += sizeof(uint64_t);
+    }
+    while (length < limit && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+HashChainMatchFinder::HashChainMatchFinder(const uint8_t* data, size_t size, const LZLevelParams& params)
+    : data_(data), size_(size), params_(params) {
+    fitTables(size, params_);
+    windowSize_ = 1u << params_.windowLog;
+    windowMask_ = windowSize_ - 1;
+    head_.assign(size_t(1) << params_.hashLog, kEmpty);
+    chain_.assign(windowSize_, kEmpty);
+}
+
+void HashChainMatchFinder::insert(size_t pos) {
+    const uint32_t h = hash4(data_ + pos, params_.hashLog);
+    chain_[pos & windowMask_] = head_[h];
+    head_[h] = static_cast<uint32_t>(pos + 1);
+}
+
+void HashChainMatchFinder::advance(size_t pos) {
+    nextInsert_ = std::max(nextInsert_, pos);
+}
+
+size_t HashChainMatchFinder::findMatches(size_t pos, LZMatch* matches) {
+    if (pos + kLZMinMatch > size_) {
+        return 0;
+    }
+    for (; nextInsert_ < pos; ++nextInsert_) {
+        insert(nextInsert_);
+    }
+
+    const uint32_t h = hash4(data_ + pos, params_.hashLog);
+    uint32_t current = head_[h];
+    chain_[pos & windowMask_] = current;
+    head_[h] = static_cast<uint32_t>(pos + 1);
+    nextInsert_ = pos + 1;
+
+    const size_t limit = size_ - pos;
+    const uint8_t* target = data_ + pos;
+    size_t best = kLZMinMatch - 1;
+    size_t count = 0;
+    for (unsigned depth = params_.searchDepth; current != kEmpty && depth > 0; --depth) {
+        const size_t candidate = current - 1;
+        const size_t distance = pos - candidate;
+        if (distance >= windowSize_) {
+            break;
+        }
+        const uint8_t* source = data_ + candidate;
+        // 先比较当前最优长度处的字节，快速排除不可能更长的候选
+        if (source[best] == target[best] && read32(source) == read32(target)) {
+            const size_t length = lzCommonLength(source, target, limit);
+            if (length > best) {
+                best = length;
+                matches[count++] = {static_cast<uint32_t>(length), static_cast<uint32_t>(distance)};
+                if (length >= params_.niceLength || length == limit || count == kLZMaxMatchesPerPosition) {
+                    break;
+                }
+            }
+        }
+        const uint32_t next = chain_[candidate & windowMask_];
+        if (next >= current) {
+            break;
+        }
+        current = next;
+    }
+    return count;
+}
+
+BinaryTreeMatchFinder::BinaryTreeMatchFinder(const uint8_t* data, size_t size, const LZLevelParams& params)
+    : data_(data), size_(size), params_(params) {
+    fitTables(size, params_);
+    windowSize_ = 1u << params_.windowLog;
+    windowMask_ = windowSize_ - 1;
+    head_.assign(size_t(1) << params_.hashLog, kEmpty);
+    tree_.assign(size_t(windowSize_) * 2, kEmpty);
+}
+
+void BinaryTreeMatchFinder::advance(size_t pos) {
+    nextInsert_ = std::max(nextInsert_, pos);
+}
+
+size_t BinaryTreeMatchFinder::findMatches(size_t pos, LZMatch* matches) {
+    if (pos + kLZMinMatch > size_) {
+        return 0;
+    }
+    for (; nextInsert_ < pos; ++nextInsert_) {
+        if (nextInsert_ + kLZMinMatch <= size_) {
+            update(nextInsert_, nullptr);
+        }
+    }
+    nextInsert_ = pos + 1;
+    return update(pos, matches);
+}
+
+size_t BinaryTreeMatchFinder::update(size_t pos, LZMatch* matches) {
+    const size_t limit = std::min<size_t>(params_.niceLength, size_ - pos);
+    const uint8_t* target = data_ + pos;
+
+    const uint32_t h = hash4(target, params_.hashLog);
+    uint32_t current = head_[h];
+    head_[h] = static_cast<uint32_t>(pos + 1);
+
+    // ptr1 挂接比当前后缀小的子树，ptr0 挂接比当前后缀大的子树
+    uint32_t* ptr0 = &tree_[((pos & windowMask_) << 1) + 1];
+    uint32_t* ptr1 = &tree_[(pos & windowMask_) << 1];
+    size_t length0 = 0;
+    size_t length1 = 0;
+    size_t best = kLZMinMatch - 1;
+    size_t count = 0;
+
+    for (unsigned depth = params_.searchDepth;; --depth) {
+        if (current == kEmpty || depth == 0) {
+            *ptr0 = *ptr1 = kEmpty;
+            break;
+        }
+        const size_t candidate = current - 1;
+        const size_t distance = pos - candidate;
+        if (distance >= windowSize_) {
+            *ptr0 = *ptr1 = kEmpty;
+            break;
+        }
+
+        uint32_t* pair = &tree_[(candidate & windowMask_) << 1];
+        const uint8_t* source = data_ + candidate;
+        size_t length = std::min(length0, length1);
+        length += lzCommonLength(source + length, target + length, limit - length);
+
+        if (matches && length > best && count < kLZMaxMatchesPerPosition) {
+            best = length;
+            matches[count++] = {static_cast<uint32_t>(length), static_cast<uint32_t>(distance)};
+        }
+        if (length >= limit) {
+            // 完全相同的后缀：直接继承候选的左右子树
+            *ptr1 = pair[0];
+            *ptr0 = pair[1];
+            break;
+        }
+        if (source[length] < target[length]) {
+            *ptr1 = current;
+            ptr1 = pair + 1;
+            current = *ptr1;
+            length1 = length;
+        } else {
+            *ptr0 = current;
+            ptr0 = pair;
+            current = *ptr0;
+            length0 = length;
+        }
+    }
+    return count;
+}
+
+} // namespace mrn
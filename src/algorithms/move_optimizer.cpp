@@ -1,13 +1,236 @@
 #include "algorithms/move_optimizer.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include "algorithms/suffix_array.h"
+#include "utils/varint.h"
+
 namespace mrn {
 
-MoveOptimizerResult MoveOptimizer::optimize(const std::vector<uint8_t>& input,
-                                            const std::string& mode) const {
-    (void)mode;
+namespace {
+constexpr uint8_t kModeNone = 0;
+constexpr uint8_t kModeBwt = 1;
+
+// 零游程以双射二进制写成 RUNA/RUNB 序列；其余 MTF 值 v 写成 v + 1，
+// v >= kEscapeBase 时写转义符后跟一个字节
+constexpr uint8_t kRunA = 0;
+constexpr uint8_t kRunB = 1;
+constexpr uint8_t kEscape = 255;
+constexpr unsigned kEscapeBase = 254;
+
+void writeZeroRun(std::vector<uint8_t>& out, size_t run) {
+    while (run > 0) {
+        if (run & 1) {
+            out.push_back(kRunA);
+            run = (run - 1) >> 1;
+        } else {
+            out.push_back(kRunB);
+            run = (run - 2) >> 1;
+        }
+    }
+}
+
+// BWT：行 0 为哨兵后缀，primary 为哨兵在最后一列中的行号（不输出哨兵本身）
+uint32_t forwardBwt(const uint8_t* data, size_t size, uint8_t* out) {
+    const auto sa = buildSuffixArray(data, size);
+    uint32_t primary = 0;
+    size_t written = 0;
+    out[written++] = data[size - 1];
+    for (size_t row = 1; row <= size; ++row) {
+        const int32_t suffix = sa[row - 1];
+        if (suffix == 0) {
+            primary = static_cast<uint32_t>(row);
+        } else {
+            out[written++] = data[suffix - 1];
+        }
+    }
+    return primary;
+}
+
+void inverseBwt(const uint8_t* bwt, size_t size, uint32_t primary, uint8_t* out) {
+    if (primary == 0 || primary > size) {
+        throw std::runtime_error("MoveOptimizer: invalid primary index");
+    }
+    std::array<uint32_t, 256> next{};
+    for (size_t i = 0; i < size; ++i) {
+        next[bwt[i]]++;
+    }
+    uint32_t sum = 1; // 首列第 0 行为哨兵
+    for (auto& count : next) {
+        const uint32_t c = count;
+        count = sum;
+        sum += c;
+    }
+
+    // 每行打包 (LF 映射 << 8) | 最后一列字符，逆向遍历时只需一次随机访存
+    std::vector<uint32_t> table(size + 1);
+    for (size_t row = 0; row <= size; ++row) {
+        if (row == primary) {
+            continue;
+        }
+        const uint8_t c = bwt[row < primary ? row : row - 1];
+        table[row] = (next[c]++ << 8) | c;
+    }
+    uint32_t row = 0;
+    for (size_t i = size; i-- > 0;) {
+        const uint32_t value = table[row];
+        out[i] = static_cast<uint8_t>(value);
+        row = value >> 8;
+    }
+}
+
+void encodeMtf(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    std::array<uint8_t, 256> order;
+    std::iota(order.begin(), order.end(), 0);
+    size_t run = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const uint8_t c = data[i];
+        if (order[0] == c) {
+            ++run;
+            continue;
+        }
+        writeZeroRun(out, run);
+        run = 0;
+        unsigned index = 1;
+        uint8_t previous = order[0];
+        order[0] = c;
+        while (order[index] != c) {
+            std::swap(previous, order[index]);
+            ++index;
+        }
+        order[index] = previous;
+        if (index < kEscapeBase) {
+            out.push_back(static_cast<uint8_t>(index + 1));
+        } else {
+            out.push_back(kEscape);
+            out.push_back(static_cast<uint8_t>(index - kEscapeBase));
+        }
+    }
+    writeZeroRun(out, run);
+}
+
+void decodeMtf(const uint8_t* symbols, size_t symbolCount, uint8_t* out, size_t size) {
+    std::array<uint8_t, 256> order;
+    std::iota(order.begin(), order.end(), 0);
+    size_t written = 0;
+    size_t run = 0;
+    unsigned runBit = 0;
+    auto flushRun = [&]() {
+        if (run > size - written) {
+            throw std::runtime_error("MoveOptimizer: zero run overflows block");
+        }
+        std::memset(out + written, order[0], run);
+        written += run;
+        run = 0;
+        runBit = 0;
+    };
+
+    for (size_t i = 0; i < symbolCount; ++i) {
+        const uint8_t symbol = symbols[i];
+        if (symbol <= kRunB) {
+            if (runBit >= 40) {
+                throw std::runtime_error("MoveOptimizer: zero run too long");
+            }
+            run += size_t(symbol + 1) << runBit++;
+            continue;
+        }
+        flushRun();
+        unsigned index = symbol - 1u;
+        if (symbol == kEscape) {
+            if (++i >= symbolCount || symbols[i] > 255 - kEscapeBase) {
+                throw std::runtime_error("MoveOptimizer: truncated escape");
+            }
+            index = kEscapeBase + symbols[i];
+        }
+        if (written == size) {
+            throw std::runtime_error("MoveOptimizer: symbol stream overflows block");
+        }
+        const uint8_t c = order[index];
+        std::memmove(order.data() + 1, order.data(), index);
+        order[0] = c;
+        out[written++] = c;
+    }
+    flushRun();
+    if (written != size) {
+        throw std::runtime_error("MoveOptimizer: block size mismatch");
+    }
+}
+} // namespace
+
+MoveOptimizerResult MoveOptimizer::optimize(const uint8_t* input,
+                                            size_t size,
+                                            const std::string& mode,
+                                            size_t blockSize) const {
     MoveOptimizerResult result;
-    result.data = input;
+    auto& out = result.data;
+    if (mode == "none") {
+        out.push_back(kModeNone);
+        out.insert(out.end(), input, input + size);
+        return result;
+    }
+    if (mode != "bwt" && mode != "default") {
+        throw std::runtime_error("MoveOptimizer: unknown mode: " + mode);
+    }
+
+    blockSize = std::min(std::max(blockSize, kMinBlockSize), kMaxBlockSize);
+    out.push_back(kModeBwt);
+    writeVarint(out, size);
+    writeVarint(out, blockSize);
+
+    std::vector<uint8_t> bwt(std::min(blockSize, size));
+    std::vector<uint8_t> symbols;
+    for (size_t offset = 0; offset < size; offset += blockSize) {
+        const size_t length = std::min(blockSize, size - offset);
+        const uint32_t primary = forwardBwt(input + offset, length, bwt.data());
+        symbols.clear();
+        encodeMtf(bwt.data(), length, symbols);
+        writeVarint(out, primary);
+        writeVarint(out, symbols.size());
+        out.insert(out.end(), symbols.begin(), symbols.end());
+    }
     return result;
 }
 
+std::vector<uint8_t> MoveOptimizer::restore(const uint8_t* data, size_t size) const {
+    if (size == 0) {
+        throw std::runtime_error("MoveOptimizer: empty payload");
+    }
+    if (data[0] == kModeNone) {
+        return std::vector<uint8_t>(data + 1, data + size);
+    }
+    if (data[0] != kModeBwt) {
+        throw std::runtime_error("MoveOptimizer: unknown mode");
+    }
+
+    size_t pos = 1;
+    const uint64_t originalSize = readVarint(data, size, pos);
+    const uint64_t blockSize = readVarint(data, size, pos);
+    if (blockSize < kMinBlockSize || blockSize > kMaxBlockSize) {
+        throw std::runtime_error("MoveOptimizer: invalid block size");
+    }
+
+    std::vector<uint8_t> output(originalSize);
+    std::vector<uint8_t> bwt(std::min<uint64_t>(blockSize, originalSize));
+    for (uint64_t offset = 0; offset < originalSize; offset += blockSize) {
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(blockSize, originalSize - offset));
+        const uint64_t primary = readVarint(data, size, pos);
+        const uint64_t symbolCount = readVarint(data, size, pos);
+        if (symbolCount > size - pos) {
+            throw std::runtime_error("MoveOptimizer: truncated block");
+        }
+        decodeMtf(data + pos, symbolCount, bwt.data(), length);
+        pos += symbolCount;
+        inverseBwt(bwt.data(), length, static_cast<uint32_t>(std::min<uint64_t>(primary, length + 1)),
+                   output.data() + offset);
+    }
+    if (pos != size) {
+        throw std::runtime_error("MoveOptimizer: trailing data");
+    }
+    return output;
+}
+
 } // namespace mrn
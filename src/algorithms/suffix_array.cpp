@@ -0,0 +1,176 @@
+#include "algorithms/suffix_array.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace mrn {
+
+namespace {
+// 文本末尾须为唯一且最小的哨兵符号 0；n 含哨兵，k 为字母表大小
+template <typename Sym>
+class SaisBuilder {
+public:
+    SaisBuilder(const Sym* text, int32_t* sa, int32_t n, int32_t k)
+        : text_(text), sa_(sa), n_(n), k_(k), types_(static_cast<size_t>(n)), buckets_(static_cast<size_t>(k) + 1) {}
+
+    void run() {
+        classify();
+
+        // 第一步：把 LMS 位置放入各桶尾部，诱导排序出有序的 LMS 子串
+        std::fill(sa_, sa_ + n_, -1);
+        bucketEnds();
+        for (int32_t i = 1; i < n_; ++i) {
+            if (isLms(i)) {
+                sa_[--bucket_[text_[i]]] = i;
+            }
+        }
+        induceL();
+        induceS();
+
+        // 将有序的 LMS 子串压缩到 SA 前部并命名
+        int32_t lmsCount = 0;
+        for (int32_t i = 0; i < n_; ++i) {
+            if (isLms(sa_[i])) {
+                sa_[lmsCount++] = sa_[i];
+            }
+        }
+        std::fill(sa_ + lmsCount, sa_ + n_, -1);
+        int32_t names = 0;
+        int32_t previous = -1;
+        for (int32_t i = 0; i < lmsCount; ++i) {
+            const int32_t position = sa_[i];
+            if (previous < 0 || !sameLmsSubstring(position, previous)) {
+                ++names;
+                previous = position;
+            }
+            sa_[lmsCount + position / 2] = names - 1;
+        }
+        for (int32_t i = n_ - 1, j = n_ - 1; i >= lmsCount; --i) {
+            if (sa_[i] >= 0) {
+                sa_[j--] = sa_[i];
+            }
+        }
+
+        // 第二步：名字不唯一时递归求解缩减问题，否则直接得到 LMS 后缀顺序
+        int32_t* reduced = sa_ + n_ - lmsCount;
+        if (names < lmsCount) {
+            SaisBuilder<int32_t>(reduced, sa_, lmsCount, names).run();
+        } else {
+            for (int32_t i = 0; i < lmsCount; ++i) {
+                sa_[reduced[i]] = i;
+            }
+        }
+
+        // 第三步：由有序的 LMS 后缀诱导出完整后缀数组
+        for (int32_t i = 1, j = 0; i < n_; ++i) {
+            if (isLms(i)) {
+                reduced[j++] = i;
+            }
+        }
+        for (int32_t i = 0; i < lmsCount; ++i) {
+            sa_[i] = reduced[sa_[i]];
+        }
+        std::fill(sa_ + lmsCount, sa_ + n_, -1);
+        bucketEnds();
+        for (int32_t i = lmsCount - 1; i >= 0; --i) {
+            const int32_t position = sa_[i];
+            sa_[i] = -1;
+            sa_[--bucket_[text_[position]]] = position;
+        }
+        induceL();
+        induceS();
+    }
+
+private:
+    const Sym* text_;
+    int32_t* sa_;
+    int32_t n_;
+    int32_t k_;
+    std::vector<uint8_t> types_; // 1 为 S 型，0 为 L 型
+    std::vector<int32_t> buckets_;
+    std::vector<int32_t> bucket_;
+
+    void classify() {
+        types_[n_ - 1] = 1;
+        for (int32_t i = n_ - 2; i >= 0; --i) {
+            types_[i] = text_[i] < text_[i + 1] || (text_[i] == text_[i + 1] && types_[i + 1]);
+        }
+        for (int32_t i = 0; i < n_; ++i) {
+            buckets_[text_[i] + 1]++;
+        }
+        for (int32_t c = 1; c <= k_; ++c) {
+            buckets_[c] += buckets_[c - 1];
+        }
+    }
+
+    bool isLms(int32_t i) const {
+        return i > 0 && types_[i] && !types_[i - 1];
+    }
+
+    void bucketStarts() {
+        bucket_.assign(buckets_.begin(), buckets_.end() - 1);
+    }
+
+    void bucketEnds() {
+        bucket_.assign(buckets_.begin() + 1, buckets_.end());
+    }
+
+    void induceL() {
+        bucketStarts();
+        for (int32_t i = 0; i < n_; ++i) {
+            const int32_t j = sa_[i] - 1;
+            if (j >= 0 && !types_[j]) {
+                sa_[bucket_[text_[j]]++] = j;
+            }
+        }
+    }
+
+    void induceS() {
+        bucketEnds();
+        for (int32_t i = n_ - 1; i >= 0; --i) {
+            const int32_t j = sa_[i] - 1;
+            if (j >= 0 && types_[j]) {
+                sa_[--bucket_[text_[j]]] = j;
+            }
+        }
+    }
+
+    // 两个 LMS 子串（含结尾的 LMS 字符）的字符与类型完全一致时同名
+    bool sameLmsSubstring(int32_t a, int32_t b) const {
+        for (int32_t d = 0;; ++d) {
+            if (text_[a + d] != text_[b + d] || types_[a + d] != types_[b + d]) {
+                return false;
+            }
+            if (d > 0 && (isLms(a + d) || isLms(b + d))) {
+                return isLms(a + d) && isLms(b + d);
+            }
+        }
+    }
+};
+} // namespace
+
+std::vector<int32_t> buildSuffixArray(const uint8_t* data, size_t size) {
+    if (size >= static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+        throw std::runtime_error("buildSuffixArray: input too large");
+    }
+    if (size == 0) {
+        return {};
+    }
+
+    // 字节整体加 1，让 0 作为唯一的哨兵
+    const auto n = static_cast<int32_t>(size + 1);
+    std::vector<uint16_t> text(static_cast<size_t>(n));
+    for (size_t i = 0; i < size; ++i) {
+        text[i] = static_cast<uint16_t>(data[i] + 1);
+    }
+    text[size] = 0;
+
+    std::vector<int32_t> sa(static_cast<size_t>(n));
+    SaisBuilder<uint16_t>(text.data(), sa.data(), n, 257).run();
+    // 首项必为哨兵后缀
+    sa.erase(sa.begin());
+    return sa;
+}
+
+} // namespace mrn
@@ -0,0 +1,358 @@
+#include "algorithms/tans_encoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "algorithms/bit_stream.h"
+#include "utils/byte_histogram.h"
+#include "utils/varint.h"
+
+namespace mrn {
+
+namespace {
+// 负载首字节标记
+constexpr uint8_t kModeRaw = 0;
+constexpr uint8_t kModeTans = 1;
+constexpr uint8_t kModeRle = 2; // 只有一种符号
+
+constexpr size_t kMinEncodeSize = 16;
+
+unsigned highBit(uint32_t value) {
+    return 31 - static_cast<unsigned>(__builtin_clz(value));
+}
+
+std::vector<uint8_t> storeRaw(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> result;
+    result.reserve(size + 1);
+    result.push_back(kModeRaw);
+    result.insert(result.end(), data, data + size);
+    return result;
+}
+
+// FSE 式符号铺排：以与表大小互质的步长把每个符号分散到状态表中
+void spreadSymbols(const uint16_t* normalized, unsigned tableLog, uint8_t* tableSymbol) {
+    const uint32_t tableSize = 1u << tableLog;
+    const uint32_t mask = tableSize - 1;
+    const uint32_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+    uint32_t position = 0;
+    for (int s = 0; s < 256; ++s) {
+        for (uint32_t i = 0; i < normalized[s]; ++i) {
+            tableSymbol[position] = static_cast<uint8_t>(s);
+            position = (position + step) & mask;
+        }
+    }
+}
+
+struct EncodeSymbol {
+    int32_t deltaFindState = 0;
+    uint32_t deltaNbBits = 0;
+};
+
+struct DecodeEntry {
+    uint16_t newStateBase;
+    uint8_t symbol;
+    uint8_t nbBits;
+};
+} // namespace
+
+unsigned TansEncoder::chooseTableLog(const uint64_t* frequencies, uint64_t total) {
+    unsigned symbols = 0;
+    for (int s = 0; s < 256; ++s) {
+        symbols += frequencies[s] > 0;
+    }
+    unsigned tableLog = kDefaultTableLog;
+    // 数据量小时缩小表，减少表头与建表开销
+    const unsigned sizeLog = total > 1 ? highBit(static_cast<uint32_t>(std::min<uint64_t>(total - 1, 0xFFFFFFFFu))) + 1 : 1;
+    if (sizeLog < tableLog + 2) {
+        tableLog = sizeLog > 2 ? sizeLog - 2 : 1;
+    }
+    const unsigned symbolLog = symbols > 1 ? highBit(symbols - 1) + 2 : 1;
+    tableLog = std::max(tableLog, symbolLog);
+    return std::min(std::max(tableLog, kMinTableLog), kMaxTableLog);
+}
+
+void TansEncoder::normalizeCounts(const uint64_t* frequencies, uint64_t total,
+                                  unsigned tableLog, uint16_t* normalized) {
+    const uint64_t tableSize = uint64_t(1) << tableLog;
+    std::array<uint64_t, 256> remainder{};
+    int64_t distributed = 0;
+    for (int s = 0; s < 256; ++s) {
+        normalized[s] = 0;
+        if (frequencies[s] == 0) {
+            continue;
+        }
+        const uint64_t scaled = frequencies[s] * tableSize;
+        uint64_t count = scaled / total;
+        remainder[s] = scaled % total;
+        if (count == 0) {
+            count = 1;
+            remainder[s] = 0;
+        }
+        normalized[s] = static_cast<uint16_t>(count);
+        distributed += static_cast<int64_t>(count);
+    }
+
+    int64_t missing = static_cast<int64_t>(tableSize) - distributed;
+    if (missing > 0) {
+        // 按舍去的小数部分从大到小补齐
+        std::array<uint16_t, 256> order;
+        int n = 0;
+        for (int s = 0; s < 256; ++s) {
+            if (normalized[s]) {
+                order[n++] = static_cast<uint16_t>(s);
+            }
+        }
+        std::sort(order.begin(), order.begin() + n, [&](uint16_t a, uint16_t b) {
+            return remainder[a] != remainder[b] ? remainder[a] > remainder[b] : a < b;
+        });
+        for (int i = 0; missing > 0; i = (i + 1) % n, --missing) {
+            normalized[order[i]]++;
+        }
+    }
+    while (missing < 0) {
+        // 强制置 1 的稀有符号挤占了空间，从计数最大的符号中扣回
+        int largest = 0;
+        for (int s = 1; s < 256; ++s) {
+            if (normalized[s] > normalized[largest]) {
+                largest = s;
+            }
+        }
+        const int64_t take = std::min<int64_t>(-missing, std::max<int64_t>(1, (normalized[largest] - 1) / 4));
+        normalized[largest] = static_cast<uint16_t>(normalized[largest] - take);
+        missing += take;
+    }
+}
+
+uint64_t TansEncoder::encodedBits(const uint64_t* frequencies, const uint16_t* normalized, unsigned tableLog) {
+    double bits = 0.0;
+    for (int s = 0; s < 256; ++s) {
+        if (frequencies[s]) {
+            bits += static_cast<double>(frequencies[s]) *
+                    (static_cast<double>(tableLog) - std::log2(static_cast<double>(normalized[s])));
+        }
+    }
+    return static_cast<uint64_t>(bits) + 2 * tableLog;
+}
+
+std::vector<uint8_t> TansEncoder::encode(const std::vector<uint8_t>& data) const {
+    return encode(data.data(), data.size());
+}
+
+std::vector<uint8_t> TansEncoder::encode(const uint8_t* data, size_t size) const {
+    if (size == 0) {
+        return {};
+    }
+    if (size < kMinEncodeSize) {
+        return storeRaw(data, size);
+    }
+
+    const ByteHistogram frequencies = byteHistogram(data, size);
+
+    int lastSymbol = 255;
+    while (frequencies[lastSymbol] == 0) {
+        --lastSymbol;
+    }
+    if (frequencies[lastSymbol] == size) {
+        std::vector<uint8_t> result;
+        result.push_back(kModeRle);
+        writeVarint(result, size);
+        result.push_back(static_cast<uint8_t>(lastSymbol));
+        return result;
+    }
+
+    const unsigned tableLog = chooseTableLog(frequencies.data(), size);
+    std::array<uint16_t, 256> normalized{};
+    normalizeCounts(frequencies.data(), size, tableLog, normalized.data());
+
+    // 表头：模式、原始长度、tableLog、最大符号、各符号归一化计数
+    std::vector<uint8_t> result;
+    result.push_back(kModeTans);
+    writeVarint(result, size);
+    result.push_back(static_cast<uint8_t>(tableLog));
+    result.push_back(static_cast<uint8_t>(lastSymbol));
+    for (int s = 0; s <= lastSymbol; ++s) {
+        writeVarint(result, normalized[s]);
+    }
+
+    const uint64_t payloadBytes = encodedBits(frequencies.data(), normalized.data(), tableLog) / 8 + 1;
+    if (result.size() + payloadBytes >= size + 1) {
+        return storeRaw(data, size);
+    }
+
+    // 编码表：stateTable 按符号分段存放下一状态，symbolTT 给出位数与分段偏移
+    const uint32_t tableSize = 1u << tableLog;
+    std::vector<uint8_t> tableSymbol(tableSize);
+    spreadSymbols(normalized.data(), tableLog, tableSymbol.data());
+
+    std::array<uint32_t, 257> cumulative{};
+    for (int s = 0; s < 256; ++s) {
+        cumulative[s + 1] = cumulative[s] + normalized[s];
+    }
+    std::vector<uint16_t> stateTable(tableSize);
+    {
+        std::array<uint32_t, 257> next = cumulative;
+        for (uint32_t u = 0; u < tableSize; ++u) {
+            stateTable[next[tableSymbol[u]]++] = static_cast<uint16_t>(tableSize + u);
+        }
+    }
+    std::array<EncodeSymbol, 256> symbolTT{};
+    for (int s = 0; s < 256; ++s) {
+        const uint32_t count = normalized[s];
+        if (count == 0) {
+            continue;
+        }
+        const uint32_t bitsOut = tableLog - (count > 1 ? highBit(count - 1) : 0);
+        const uint32_t minStatePlus = count << bitsOut;
+        symbolTT[s].deltaNbBits = (bitsOut << 16) - minStatePlus;
+        symbolTT[s].deltaFindState = static_cast<int32_t>(cumulative[s]) - static_cast<int32_t>(count);
+    }
+
+    const size_t headerSize = result.size();
+    result.resize(headerSize + size * tableLog / 8 + 32);
+    BitWriter writer(result.data() + headerSize);
+
+    // 逆序编码；符号 i 使用状态 (i & 1)，解码时按正序交替恢复
+    uint32_t states[2] = {tableSize, tableSize};
+    auto encodeSymbol = [&](uint32_t& state, uint8_t symbol) {
+        const EncodeSymbol& tt = symbolTT[symbol];
+        const uint32_t nbBits = (state + tt.deltaNbBits) >> 16;
+        writer.write(state & ((1u << nbBits) - 1), nbBits);
+        state = stateTable[static_cast<int32_t>(state >> nbBits) + tt.deltaFindState];
+    };
+
+    size_t i = size;
+    if (i & 1) {
+        --i;
+        encodeSymbol(states[0], data[i]);
+        writer.flush();
+    }
+    if (i & 2) {
+        i -= 2;
+        encodeSymbol(states[1], data[i + 1]);
+        encodeSymbol(states[0], data[i]);
+        writer.flush();
+    }
+    while (i > 0) {
+        i -= 4;
+        encodeSymbol(states[1], data[i + 3]);
+        encodeSymbol(states[0], data[i + 2]);
+        encodeSymbol(states[1], data[i + 1]);
+        encodeSymbol(states[0], data[i]);
+        writer.flush();
+    }
+
+    writer.write(states[1] - tableSize, tableLog);
+    writer.write(states[0] - tableSize, tableLog);
+    writer.write(1, 1); // 终止标记位
+    result.resize(headerSize + writer.finish());
+
+    if (result.size() >= size + 1) {
+        return storeRaw(data, size);
+    }
+    return result;
+}
+
+std::vector<uint8_t> TansEncoder::decode(const std::vector<uint8_t>& data) const {
+    return decode(data.data(), data.size());
+}
+
+std::vector<uint8_t> TansEncoder::decode(const uint8_t* data, size_t size) const {
+    if (size == 0) {
+        return {};
+    }
+
+    const uint8_t mode = data[0];
+    if (mode == kModeRaw) {
+        return std::vector<uint8_t>(data + 1, data + size);
+    }
+
+    size_t pos = 1;
+    const uint64_t symbolCount = readVarint(data, size, pos);
+    if (mode == kModeRle) {
+        if (pos >= size) {
+            throw std::runtime_error("TansEncoder: truncated RLE block");
+        }
+        return std::vector<uint8_t>(symbolCount, data[pos]);
+    }
+    if (mode != kModeTans) {
+        throw std::runtime_error("TansEncoder: unknown block mode " + std::to_string(mode));
+    }
+
+    if (pos + 2 > size) {
+        throw std::runtime_error("TansEncoder: truncated header");
+    }
+    const unsigned tableLog = data[pos++];
+    const int lastSymbol = data[pos++];
+    if (tableLog < kMinTableLog || tableLog > kMaxTableLog) {
+        throw std::runtime_error("TansEncoder: invalid table log");
+    }
+
+    const uint32_t tableSize = 1u << tableLog;
+    std::array<uint16_t, 256> normalized{};
+    uint64_t sum = 0;
+    for (int s = 0; s <= lastSymbol; ++s) {
+        const uint64_t count = readVarint(data, size, pos);
+        sum += count;
+        if (sum > tableSize) {
+            throw std::runtime_error("TansEncoder: invalid normalized counts");
+        }
+        normalized[s] = static_cast<uint16_t>(count);
+    }
+    if (sum != tableSize) {
+        throw std::runtime_error("TansEncoder: invalid normalized counts");
+    }
+
+    // 解码表：每个状态给出符号、需读取的位数和下一状态基址
+    std::vector<uint8_t> tableSymbol(tableSize);
+    spreadSymbols(normalized.data(), tableLog, tableSymbol.data());
+    std::vector<DecodeEntry> table(tableSize);
+    std::array<uint32_t, 256> symbolNext{};
+    for (int s = 0; s < 256; ++s) {
+        symbolNext[s] = normalized[s];
+    }
+    for (uint32_t u = 0; u < tableSize; ++u) {
+        const uint8_t symbol = tableSymbol[u];
+        const uint32_t x = symbolNext[symbol]++;
+        const unsigned nbBits = tableLog - highBit(x);
+        table[u].symbol = symbol;
+        table[u].nbBits = static_cast<uint8_t>(nbBits);
+        table[u].newStateBase = static_cast<uint16_t>((x << nbBits) - tableSize);
+    }
+
+    BackwardBitReader reader(data + pos, size - pos);
+    uint32_t states[2];
+    states[0] = static_cast<uint32_t>(reader.read(tableLog));
+    states[1] = static_cast<uint32_t>(reader.read(tableLog));
+    reader.reload();
+
+    std::vector<uint8_t> result(symbolCount);
+    uint8_t* out = result.data();
+    auto decodeSymbol = [&](uint32_t& state, size_t index) {
+        const DecodeEntry entry = table[state];
+        out[index] = entry.symbol;
+        state = entry.newStateBase + static_cast<uint32_t>(reader.read(entry.nbBits));
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= symbolCount; i += 4) {
+        decodeSymbol(states[0], i);
+        decodeSymbol(states[1], i + 1);
+        decodeSymbol(states[0], i + 2);
+        decodeSymbol(states[1], i + 3);
+        reader.reload();
+    }
+    for (; i < symbolCount; ++i) {
+        decodeSymbol(states[i & 1], i);
+        reader.reload();
+    }
+
+    if (!reader.finished()) {
+        throw std::runtime_error("TansEncoder: corrupt bitstream");
+    }
+    return result;
+}
+
+} // namespace mrn
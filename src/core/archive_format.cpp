@@ -1,9 +1,509 @@
 #include "core/archive_format.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include "core/plugin_interface.h"
+#include "core/plugin_manager.h"
+#include "utils/crc32c.h"
+#include "utils/varint.h"
+
 namespace mrn {
 
+namespace {
+// 尾部读取的长度：目录不超过这一大小时与尾部一起读入
+constexpr size_t kTailReadSize = 64 * 1024;
+// 每页条目数：页越小，查找单个条目时读取和解码的数据越少，压缩率越低
+constexpr uint32_t kEntriesPerPage = 256;
+// 小页压缩得不偿失，原样存储
+constexpr size_t kMinCompressedPage = 512;
+// 查找时每次读入的索引槽位数
+constexpr uint32_t kIndexProbeWindow = 16;
+constexpr size_t kIndexSlotSize = 6;
+
+size_t entryHeaderStride(const MRNArchiveHeader& header) {
+    return header.entryHeaderSize != 0 ? header.entryHeaderSize : MRN_LEGACY_ENTRY_HEADER_SIZE;
+}
+
+bool validEntry(const ArchiveEntry& entry) {
+    return entry.preprocessorCount <= MRN_MAX_PREPROCESSORS && entry.entryType <= MRN_ENTRY_SOLID_MEMBER;
+}
+
+ArchiveEntry fromLegacyEntry(FileEntryHeader& legacy) {
+    legacy.filename[sizeof(legacy.filename) - 1] = '\0';
+    ArchiveEntry entry;
+    entry.name = legacy.filename;
+    entry.uncompressedSize = legacy.uncompressedSize;
+    entry.compressedSize = legacy.compressedSize;
+    entry.fileOffset = legacy.fileOffset;
+    entry.checksum = legacy.checksum;
+    entry.permissions = legacy.permissions;
+    entry.compressionLevel = legacy.compressionLevel;
+    entry.flags = legacy.flags;
+    entry.preprocessorCount = legacy.preprocessorCount;
+    std::copy(std::begin(legacy.preprocessorIds), std::end(legacy.preprocessorIds), entry.preprocessorIds);
+    entry.transformedSize = legacy.transformedSize;
+    entry.entryType = legacy.entryType;
+    entry.solidBlock = legacy.solidBlock;
+    return entry;
+}
+
+void writeFixed32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+uint32_t readFixed32(const uint8_t* data, size_t size, size_t& pos) {
+    if (size - pos < 4) {
+        throw std::runtime_error("Truncated archive directory");
+    }
+    uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        value |= static_cast<uint32_t>(data[pos++]) << shift;
+    }
+    return value;
+}
+
+uint16_t readFixed16(const uint8_t* data, size_t size, size_t& pos) {
+    if (size - pos < 2) {
+        throw std::runtime_error("Truncated archive directory");
+    }
+    const uint16_t value = static_cast<uint16_t>(data[pos] | (data[pos + 1] << 8));
+    pos += 2;
+    return value;
+}
+
+uint8_t readByte(const uint8_t* data, size_t size, size_t& pos) {
+    if (pos >= size) {
+        throw std::runtime_error("Truncated archive directory");
+    }
+    return data[pos++];
+}
+
+void writeString(std::vector<uint8_t>& out, const std::string& value) {
+    writeVarint(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+std::string readString(const uint8_t* data, size_t size, size_t& pos) {
+    const uint64_t length = readVarint(data, size, pos);
+    if (length > size - pos) {
+        throw std::runtime_error("Truncated archive directory");
+    }
+    std::string value(reinterpret_cast<const char*>(data + pos), length);
+    pos += length;
+    return value;
+}
+
+void encodeEntry(std::vector<uint8_t>& raw, const ArchiveEntry& entry, const std::string* previous) {
+    // 同一目录下的路径依次写入，共享前缀通常占路径的大部分
+    size_t shared = 0;
+    if (previous) {
+        const size_t limit = std::min(previous->size(), entry.name.size());
+        while (shared < limit && (*previous)[shared] == entry.name[shared]) {
+            ++shared;
+        }
+    }
+    writeVarint(raw, shared);
+    writeVarint(raw, entry.name.size() - shared);
+    raw.insert(raw.end(), entry.name.begin() + static_cast<std::ptrdiff_t>(shared), entry.name.end());
+
+    raw.push_back(entry.entryType);
+    raw.push_back(entry.flags);
+    raw.push_back(entry.compressionLevel);
+    writeVarint(raw, entry.permissions);
+    writeVarint(raw, entry.uncompressedSize);
+    writeVarint(raw, entry.compressedSize);
+    writeVarint(raw, entry.fileOffset);
+    writeFixed32(raw, entry.checksum);
+    raw.push_back(entry.preprocessorCount);
+    for (uint8_t i = 0; i < entry.preprocessorCount; ++i) {
+        writeVarint(raw, entry.preprocessorIds[i]);
+    }
+    if (entry.preprocessorCount > 0) {
+        writeVarint(raw, entry.transformedSize);
+    }
+    if (entry.entryType == MRN_ENTRY_SOLID_MEMBER) {
+        writeVarint(raw, entry.solidBlock);
+    }
+    writeVarint(raw, entry.algorithmId);
+    writeVarint(raw, entry.algorithmParams.size());
+    for (const auto& [key, value] : entry.algorithmParams) {
+        writeString(raw, key);
+        writeString(raw, value);
+    }
+    writeVarint(raw, entry.modifiedTime);
+}
+
+// 4 版起每个条目末尾带有算法 ID 与参数，5 版起其后是修改时间
+std::vector<ArchiveEntry> decodeEntries(const std::vector<uint8_t>& raw, size_t count, uint8_t version) {
+    const uint8_t* data = raw.data();
+    const size_t size = raw.size();
+    size_t pos = 0;
+    std::vector<ArchiveEntry> entries(count);
+    const std::string* previous = nullptr;
+    for (auto& entry : entries) {
+        const uint64_t shared = readVarint(data, size, pos);
+        const uint64_t suffix = readVarint(data, size, pos);
+        if (shared > (previous ? previous->size() : 0) || suffix > size - pos) {
+            throw std::runtime_error("Corrupt path in archive directory");
+        }
+        if (previous) {
+            entry.name.assign(*previous, 0, shared);
+        }
+        entry.name.append(reinterpret_cast<const char*>(data + pos), suffix);
+        pos += suffix;
+        previous = &entry.name;
+
+        entry.entryType = readByte(data, size, pos);
+        entry.flags = readByte(data, size, pos);
+        entry.compressionLevel = readByte(data, size, pos);
+        entry.permissions = static_cast<uint16_t>(readVarint(data, size, pos));
+        entry.uncompressedSize = readVarint(data, size, pos);
+        entry.compressedSize = readVarint(data, size, pos);
+        entry.fileOffset = readVarint(data, size, pos);
+        entry.checksum = readFixed32(data, size, pos);
+        entry.preprocessorCount = readByte(data, size, pos);
+        if (!validEntry(entry)) {
+            throw std::runtime_error("Invalid entry in archive directory: " + entry.name);
+        }
+        for (uint8_t i = 0; i < entry.preprocessorCount; ++i) {
+            entry.preprocessorIds[i] = static_cast<uint32_t>(readVarint(data, size, pos));
+        }
+        if (entry.preprocessorCount > 0) {
+            entry.transformedSize = readVarint(data, size, pos);
+        }
+        if (entry.entryType == MRN_ENTRY_SOLID_MEMBER) {
+            entry.solidBlock = static_cast<uint32_t>(readVarint(data, size, pos));
+        }
+        if (version >= 4) {
+            entry.algorithmId = static_cast<uint32_t>(readVarint(data, size, pos));
+            const uint64_t params = readVarint(data, size, pos);
+            for (uint64_t i = 0; i < params; ++i) {
+                auto key = readString(data, size, pos);
+                entry.algorithmParams[std::move(key)] = readString(data, size, pos);
+            }
+        }
+        if (version >= 5) {
+            entry.modifiedTime = readVarint(data, size, pos);
+        }
+    }
+    if (pos != size) {
+        throw std::runtime_error("Trailing data in archive directory page");
+    }
+    return entries;
+}
+} // namespace
+
 bool validateHeader(const MRNArchiveHeader& header) {
     return header.magic[0] == 'M' && header.magic[1] == 'R' && header.magic[2] == 'N';
 }
 
+uint64_t hashEntryName(const std::string& name) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+std::vector<uint8_t> encodeDirectory(const std::vector<ArchiveEntry>& entries,
+                                     ICompressionAlgorithm* codec,
+                                     uint64_t offset,
+                                     MRNArchiveFooter& footer) {
+    footer.directoryOffset = offset;
+    footer.entriesPerPage = kEntriesPerPage;
+    footer.directoryAlgorithm = 0;
+
+    std::vector<uint8_t> output;
+    std::vector<uint8_t> pageTable;
+    std::vector<uint8_t> raw;
+    for (size_t first = 0; first < entries.size(); first += kEntriesPerPage) {
+        const size_t last = std::min(entries.size(), first + kEntriesPerPage);
+        raw.clear();
+        for (size_t i = first; i < last; ++i) {
+            encodeEntry(raw, entries[i], i > first ? &entries[i - 1].name : nullptr);
+        }
+
+        const std::vector<uint8_t>* stored = &raw;
+        CompressionResult compressed;
+        if (codec && raw.size() >= kMinCompressedPage) {
+            compressed = codec->compress(CompressParams{}, raw);
+            if (compressed.isCompressed && compressed.compressedData.size() < raw.size()) {
+                stored = &compressed.compressedData;
+                footer.directoryAlgorithm = codec->getAlgorithmId();
+            }
+        }
+        writeVarint(pageTable, stored->size());
+        writeVarint(pageTable, raw.size());
+        writeFixed32(pageTable, crc32c(stored->data(), stored->size()));
+        output.insert(output.end(), stored->begin(), stored->end());
+    }
+    footer.pageTableOffset = offset + output.size();
+    footer.pageTableChecksum = crc32c(pageTable.data(), pageTable.size());
+    output.insert(output.end(), pageTable.begin(), pageTable.end());
+
+    // 负载因子约 3/4：每条目约 8 字节，命中的查找平均探测两三个槽位，都在一次读入的窗口内
+    const auto slots = static_cast<uint32_t>(entries.size() + entries.size() / 3 + 1);
+    std::vector<uint16_t> tags(slots, 0);
+    std::vector<uint32_t> values(slots, 0);
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        const uint64_t hash = hashEntryName(entries[i].name);
+        uint32_t slot = static_cast<uint32_t>(hash % slots);
+        while (values[slot] != 0) {
+            slot = slot + 1 == slots ? 0 : slot + 1;
+        }
+        tags[slot] = static_cast<uint16_t>(hash >> 48);
+        values[slot] = i + 1;
+    }
+    footer.nameIndexOffset = offset + output.size();
+    footer.nameIndexSlots = slots;
+    for (uint32_t slot = 0; slot < slots; ++slot) {
+        output.push_back(static_cast<uint8_t>(tags[slot]));
+        output.push_back(static_cast<uint8_t>(tags[slot] >> 8));
+        writeFixed32(output, values[slot]);
+    }
+    return output;
+}
+
+DirectoryReader::DirectoryReader(std::istream& archive) : archive_(&archive) {
+    open();
+}
+
+DirectoryReader::DirectoryReader(const uint8_t* data, uint64_t size) : mapped_(data), mappedSize_(size) {
+    open();
+}
+
+void DirectoryReader::open() {
+    if (archiveSize() < sizeof(MRNArchiveHeader)) {
+        throw std::runtime_error("Invalid MRN archive");
+    }
+    readAt(0, reinterpret_cast<uint8_t*>(&header_), sizeof(MRNArchiveHeader));
+    if (!validateHeader(header_)) {
+        throw std::runtime_error("Invalid MRN archive");
+    }
+    if (header_.version > MRN_ARCHIVE_VERSION) {
+        throw std::runtime_error("Unsupported archive version " + std::to_string(header_.version));
+    }
+    if (header_.version >= 3) {
+        openFooter();
+    }
+}
+
+uint64_t DirectoryReader::archiveSize() {
+    if (!archive_) {
+        return mappedSize_;
+    }
+    archive_->clear();
+    archive_->seekg(0, std::ios::end);
+    const auto size = archive_->tellg();
+    return size < 0 ? 0 : static_cast<uint64_t>(size);
+}
+
+void DirectoryReader::readAt(uint64_t offset, uint8_t* out, uint64_t size) {
+    if (!archive_) {
+        if (offset > mappedSize_ || size > mappedSize_ - offset) {
+            throw std::runtime_error("Archive directory out of range");
+        }
+        std::memcpy(out, mapped_ + offset, static_cast<size_t>(size));
+        return;
+    }
+    archive_->clear();
+    archive_->seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    archive_->read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(size));
+    if (!*archive_) {
+        throw std::runtime_error("Failed to read archive directory");
+    }
+}
+
+void DirectoryReader::openFooter() {
+    const uint64_t fileSize = archiveSize();
+    if (fileSize < sizeof(MRNArchiveHeader) + sizeof(MRNArchiveFooter)) {
+        throw std::runtime_error("Truncated archive");
+    }
+    // 映射的归档随取随用，不需要预读尾部
+    if (archive_) {
+        const uint64_t tailSize = std::min<uint64_t>(kTailReadSize, fileSize - sizeof(MRNArchiveHeader));
+        tailOffset_ = fileSize - tailSize;
+        tail_.resize(static_cast<size_t>(tailSize));
+        readAt(tailOffset_, tail_.data(), tailSize);
+    }
+    readAt(fileSize - sizeof(footer_), reinterpret_cast<uint8_t*>(&footer_), sizeof(footer_));
+    const uint64_t indexEnd = fileSize - sizeof(MRNArchiveFooter);
+    if (std::memcmp(footer_.magic, "MRND", 4) != 0 || footer_.entriesPerPage == 0 ||
+        footer_.directoryOffset < sizeof(MRNArchiveHeader) || footer_.directoryOffset > footer_.pageTableOffset ||
+        footer_.pageTableOffset > footer_.nameIndexOffset || footer_.nameIndexOffset > indexEnd ||
+        footer_.nameIndexSlots == 0 || indexEnd - footer_.nameIndexOffset != uint64_t(footer_.nameIndexSlots) * kIndexSlotSize) {
+        throw std::runtime_error("Invalid archive footer");
+    }
+
+    const auto table = readRange(footer_.pageTableOffset, footer_.nameIndexOffset - footer_.pageTableOffset);
+    if (crc32c(table.data(), table.size()) != footer_.pageTableChecksum) {
+        throw std::runtime_error("Archive page table checksum mismatch");
+    }
+    const uint64_t pageCount = (uint64_t(header_.fileCount) + footer_.entriesPerPage - 1) / footer_.entriesPerPage;
+    size_t pos = 0;
+    uint64_t offset = footer_.directoryOffset;
+    for (uint64_t i = 0; i < pageCount; ++i) {
+        Page page;
+        page.offset = offset;
+        page.storedSize = readVarint(table.data(), table.size(), pos);
+        page.rawSize = readVarint(table.data(), table.size(), pos);
+        page.checksum = readFixed32(table.data(), table.size(), pos);
+        if (page.storedSize > footer_.pageTableOffset - offset || page.storedSize > page.rawSize) {
+            throw std::runtime_error("Invalid archive page table");
+        }
+        offset += page.storedSize;
+        pages_.push_back(page);
+    }
+    if (pos != table.size() || offset != footer_.pageTableOffset) {
+        throw std::runtime_error("Invalid archive page table");
+    }
+}
+
+std::vector<uint8_t> DirectoryReader::readRange(uint64_t offset, uint64_t size) {
+    if (offset >= tailOffset_ && !tail_.empty()) {
+        const auto begin = tail_.begin() + static_cast<std::ptrdiff_t>(offset - tailOffset_);
+        return std::vector<uint8_t>(begin, begin + static_cast<std::ptrdiff_t>(size));
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    readAt(offset, data.data(), size);
+    return data;
+}
+
+std::vector<ArchiveEntry> DirectoryReader::decodePage(uint32_t index, const uint8_t* stored) {
+    const Page& page = pages_[index];
+    if (crc32c(stored, page.storedSize) != page.checksum) {
+        throw std::runtime_error("Archive directory checksum mismatch");
+    }
+    const size_t count = std::min<uint64_t>(footer_.entriesPerPage,
+                                            header_.fileCount - uint64_t(index) * footer_.entriesPerPage);
+    std::vector<uint8_t> raw;
+    if (page.storedSize == page.rawSize) {
+        raw.assign(stored, stored + page.storedSize);
+    } else {
+        auto* codec = PluginManager::getInstance().getAlgorithmById(footer_.directoryAlgorithm);
+        if (!codec) {
+            throw std::runtime_error("Archive directory uses an unavailable algorithm");
+        }
+        DecompressParams params;
+        params.expectedSize = page.rawSize;
+        params.dataIsCompressed = true;
+        codec->decompressInto(params, ByteView(stored, page.storedSize), raw);
+        if (raw.size() != page.rawSize) {
+            throw std::runtime_error("Archive directory size mismatch");
+        }
+    }
+    return decodeEntries(raw, count, header_.version);
+}
+
+const std::vector<ArchiveEntry>& DirectoryReader::legacyEntries() {
+    if (legacyLoaded_) {
+        return legacyEntries_;
+    }
+    // 1、2 版：定长条目表紧跟在数据区之后，整表一次读入；较短的旧条目缺失的扩展字段保持为 0
+    const size_t stride = entryHeaderStride(header_);
+    const auto table = readRange(sizeof(MRNArchiveHeader) + header_.totalCompressedSize,
+                                 uint64_t(header_.fileCount) * stride);
+    legacyEntries_.reserve(header_.fileCount);
+    for (uint32_t i = 0; i < header_.fileCount; ++i) {
+        FileEntryHeader legacy{};
+        std::memcpy(&legacy, table.data() + size_t(i) * stride, std::min(stride, sizeof(FileEntryHeader)));
+        legacyEntries_.push_back(fromLegacyEntry(legacy));
+        if (!validEntry(legacyEntries_.back())) {
+            throw std::runtime_error("Invalid file entry " + std::to_string(i));
+        }
+    }
+    legacyLoaded_ = true;
+    return legacyEntries_;
+}
+
+uint64_t DirectoryReader::dataEnd() const {
+    return header_.version >= 3 ? footer_.directoryOffset : sizeof(MRNArchiveHeader) + header_.totalCompressedSize;
+}
+
+std::vector<ArchiveEntry> DirectoryReader::readAll() {
+    if (header_.version < 3) {
+        return legacyEntries();
+    }
+    std::vector<ArchiveEntry> entries;
+    entries.reserve(header_.fileCount);
+    const auto pages = readRange(footer_.directoryOffset, footer_.pageTableOffset - footer_.directoryOffset);
+    for (uint32_t i = 0; i < pages_.size(); ++i) {
+        auto page = decodePage(i, pages.data() + (pages_[i].offset - footer_.directoryOffset));
+        std::move(page.begin(), page.end(), std::back_inserter(entries));
+    }
+    return entries;
+}
+
+const ArchiveEntry& DirectoryReader::entry(uint32_t index) {
+    if (index >= header_.fileCount) {
+        throw std::runtime_error("Entry index out of range");
+    }
+    if (header_.version < 3) {
+        return legacyEntries()[index];
+    }
+    const uint32_t pageIndex = index / footer_.entriesPerPage;
+    auto it = loadedPages_.find(pageIndex);
+    if (it == loadedPages_.end()) {
+        const Page& page = pages_[pageIndex];
+        const auto stored = readRange(page.offset, page.storedSize);
+        it = loadedPages_.emplace(pageIndex, decodePage(pageIndex, stored.data())).first;
+    }
+    return it->second[index % footer_.entriesPerPage];
+}
+
+bool DirectoryReader::find(const std::string& name, uint32_t& index) {
+    if (header_.version < 3) {
+        const auto& entries = legacyEntries();
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].name == name) {
+                index = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (header_.fileCount == 0) {
+        return false;
+    }
+
+    const uint64_t hash = hashEntryName(name);
+    const auto tag = static_cast<uint16_t>(hash >> 48);
+    uint32_t slot = static_cast<uint32_t>(hash % footer_.nameIndexSlots);
+    for (uint32_t probed = 0; probed < footer_.nameIndexSlots;) {
+        // 按窗口读入连续槽位，不越过表尾
+        const uint32_t window = std::min(kIndexProbeWindow, footer_.nameIndexSlots - slot);
+        const auto slots = readRange(footer_.nameIndexOffset + uint64_t(slot) * kIndexSlotSize,
+                                     uint64_t(window) * kIndexSlotSize);
+        for (uint32_t i = 0; i < window && probed < footer_.nameIndexSlots; ++i, ++probed) {
+            size_t pos = i * kIndexSlotSize;
+            const uint16_t slotTag = readFixed16(slots.data(), slots.size(), pos);
+            const uint32_t value = readFixed32(slots.data(), slots.size(), pos);
+            if (value == 0) {
+                return false;
+            }
+            // 哈希标签只用于筛选，命中后以目录中的路径为准
+            if (slotTag == tag && value <= header_.fileCount && entry(value - 1).name == name) {
+                index = value - 1;
+                return true;
+            }
+        }
+        slot = (slot + window) % footer_.nameIndexSlots;
+    }
+    return false;
+}
+
+ArchiveDirectory readArchiveDirectory(std::istream& archive) {
+    DirectoryReader reader(archive);
+    ArchiveDirectory directory;
+    directory.header = reader.header();
+    directory.entries = reader.readAll();
+    return directory;
+}
+
 } // namespace mrn
@@ -0,0 +1,38 @@
+#include "core/chunk_store.h"
+
+namespace mrn {
+
+uint32_t ChunkStore::acquire(const ChunkDigest& digest, bool& owner) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(digest);
+    if (it != index_.end()) {
+        owner = false;
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
+    slots_.back().chunk = slots_.back().promise.get_future().share();
+    index_.emplace(digest, id);
+    owner = true;
+    return id;
+}
+
+void ChunkStore::publish(uint32_t id, StoredChunk chunk) {
+    slot(id).promise.set_value(std::move(chunk));
+}
+
+void ChunkStore::fail(uint32_t id, std::exception_ptr error) {
+    slot(id).promise.set_exception(error);
+}
+
+ChunkStore::Slot& ChunkStore::slot(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.at(id);
+}
+
+size_t ChunkStore::uniqueChunks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.size();
+}
+
+} // namespace mrn
@@ -1,19 +1,38 @@
 #include "core/compressor.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fnmatch.h>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
+#include <unordered_map>
+#include <zlib.h>
 
+#include "algorithms/dictionary_trainer.h"
 #include "core/archive_format.h"
+#include "core/chunk_store.h"
 #include "core/config.h"
+#include "core/pipeline_executor.h"
 #include "core/plugin_interface.h"
+#include "io/archive_reader.h"
 #include "io/archive_writer.h"
 #include "io/directory_scanner.h"
 #include "io/file_io.h"
+#include "utils/content_chunker.h"
+#include "utils/crc32c.h"
 #include "utils/logger.h"
+#include "utils/varint.h"
 
 namespace mrn {
 
@@ -29,15 +48,358 @@ CompressParams buildParams(const CompressionPipeline& pipeline,
     return params;
 }
 
-uint32_t calculateChecksum(const std::vector<uint8_t>& data) {
-    uint32_t checksum = 0;
-    for (uint8_t byte : data) {
-        checksum = (checksum << 1) ^ byte;
-        if (checksum & 0x80000000) {
-            checksum = (checksum << 1) ^ 0x04C11DB7; // CRC32 polynomial
+// 元数据取自打开文件时（读取内容之前）的 fstat，读取期间的改动会让修改时间与记录的不同
+void readFileMetadata(const MappedFile& input, FileCompressionResult& result) {
+    result.filePermissions = input.permissions();
+    result.modifiedTime = input.modifiedTime();
+}
+
+// 较大的输入由算法先试压开头，压缩后仍不小于原始大小的该比例时整体存储，省去其余数据的压缩
+constexpr double kIncompressibleRatio = 0.98;
+// 切块文件的前几块都只能存储时，后续块不再尝试压缩
+constexpr uint64_t kAbortAfterStoredBlocks = 2;
+
+// 流式压缩每次从输入读取的字节数
+constexpr size_t kStreamReadSize = 1024 * 1024;
+
+// 块引用记录的标志位
+constexpr uint8_t kChunkRefCompressed = 0x01;
+
+// 不超过该大小的文件使用共享字典；小文件足够多时才训练
+constexpr uint64_t kDictionaryFileLimit = 32 * 1024;
+constexpr size_t kMinDictionarySamples = 16;
+constexpr uint64_t kMaxDictionarySampleBytes = 4 * 1024 * 1024;
+constexpr size_t kDictionaryTrialBytes = 512 * 1024;
+
+const std::vector<uint8_t>* dictionaryFor(const std::vector<uint8_t>* dictionary, size_t size) {
+    return dictionary && !dictionary->empty() && size <= kDictionaryFileLimit ? dictionary : nullptr;
+}
+
+// 增量归档：参照归档中同路径的条目大小与修改时间都与文件一致时返回该条目。
+// 以共享字典压缩的条目要求新归档沿用同一字典；核对内容时要求条目带有 CRC32C
+const ArchiveEntry* findUnchanged(const std::unordered_map<std::string, ArchiveEntry>& reference,
+                                  const DirectoryScanner::FileInfo& file,
+                                  bool dictionaryMatches,
+                                  bool verifyHash) {
+    auto it = reference.find(file.relativePath);
+    if (it == reference.end()) {
+        return nullptr;
+    }
+    const auto& entry = it->second;
+    if (entry.uncompressedSize != file.size || entry.modifiedTime != file.modifiedTime ||
+        ((entry.flags & MRN_FILE_FLAG_DICTIONARY) && !dictionaryMatches) ||
+        (verifyHash && !(entry.flags & MRN_FILE_FLAG_CRC32C))) {
+        return nullptr;
+    }
+    return &entry;
+}
+
+// 增量归档：打开参照归档，收集负载可以原样复制的普通条目
+std::unique_ptr<ArchiveReader> openReference(const std::string& referenceArchive, const std::string& outputFile,
+                                             std::unordered_map<std::string, ArchiveEntry>& entries) {
+    if (std::filesystem::exists(outputFile) && std::filesystem::equivalent(referenceArchive, outputFile)) {
+        throw std::runtime_error("Reference archive must differ from the output archive");
+    }
+    auto reference = std::make_unique<ArchiveReader>(referenceArchive);
+    for (auto entry : reference->entries()) {
+        if (entry.entryType == MRN_ENTRY_FILE && !(entry.flags & MRN_FILE_FLAG_CHUNKED) && entry.modifiedTime != 0) {
+            auto name = entry.name;
+            entries.emplace(std::move(name), std::move(entry));
         }
     }
-    return checksum;
+    return reference;
+}
+
+// 竞速模式：较大的输入取均匀分布的几段拼接为样本试压，过小的输入不值得竞速
+constexpr size_t kRaceSliceSize = 64 * 1024;
+constexpr size_t kRaceSlices = 4;
+constexpr size_t kRaceMinInput = 4 * 1024;
+constexpr int kRaceMinLevel = 1;
+constexpr int kRaceMaxLevel = 9;
+
+std::vector<uint8_t> raceSample(ByteView data) {
+    std::vector<uint8_t> sample;
+    sample.reserve(kRaceSliceSize * kRaceSlices);
+    const size_t stride = (data.size() - kRaceSliceSize) / (kRaceSlices - 1);
+    for (size_t i = 0; i < kRaceSlices; ++i) {
+        const auto slice = data.subview(i * stride, kRaceSliceSize);
+        sample.insert(sample.end(), slice.begin(), slice.end());
+    }
+    return sample;
+}
+
+// 记录条目所用的算法与参数，解压时据此选择算法
+void recordAlgorithm(const CompressionPipeline& pipeline, const ICompressionAlgorithm& algorithm,
+                     FileCompressionResult& result) {
+    result.algorithmId = algorithm.getAlgorithmId();
+    auto it = pipeline.algorithmConfigs.find(pipeline.mainAlgorithm);
+    if (it != pipeline.algorithmConfigs.end()) {
+        result.algorithmParams = it->second.values;
+    }
+}
+
+} // namespace
+
+// 切块条目的块记录：[varint 压缩大小][varint 原始大小][u8 标志][u8 预处理器数]
+// [varint 预处理器 ID...][varint 预处理后大小（有预处理器时）][u32 CRC32]
+struct BlockRecord {
+    uint64_t compressedSize = 0;
+    uint64_t uncompressedSize = 0;
+    uint8_t flags = 0;
+    std::vector<uint32_t> preprocessorIds;
+    uint64_t transformedSize = 0;
+    uint32_t crc = 0;
+    uint64_t offset = 0; // 块在归档中的绝对位置（读取块表时计算，不写入）
+};
+
+namespace {
+
+void appendBlockRecord(std::vector<uint8_t>& table, const BlockRecord& record) {
+    writeVarint(table, record.compressedSize);
+    writeVarint(table, record.uncompressedSize);
+    table.push_back(record.flags);
+    table.push_back(static_cast<uint8_t>(record.preprocessorIds.size()));
+    for (uint32_t id : record.preprocessorIds) {
+        writeVarint(table, id);
+    }
+    if (!record.preprocessorIds.empty()) {
+        writeVarint(table, record.transformedSize);
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        table.push_back(static_cast<uint8_t>(record.crc >> shift));
+    }
+}
+
+BlockRecord readBlockRecord(ByteView table, size_t& pos) {
+    BlockRecord record;
+    record.compressedSize = readVarint(table.data(), table.size(), pos);
+    record.uncompressedSize = readVarint(table.data(), table.size(), pos);
+    if (table.size() - pos < 2) {
+        throw std::runtime_error("Truncated block table");
+    }
+    record.flags = table[pos++];
+    const uint8_t count = table[pos++];
+    if (count > MRN_MAX_PREPROCESSORS) {
+        throw std::runtime_error("Too many preprocessors in block");
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        record.preprocessorIds.push_back(static_cast<uint32_t>(readVarint(table.data(), table.size(), pos)));
+    }
+    if (count > 0) {
+        record.transformedSize = readVarint(table.data(), table.size(), pos);
+    }
+    if (table.size() - pos < 4) {
+        throw std::runtime_error("Truncated block table");
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        record.crc |= static_cast<uint32_t>(table[pos++]) << shift;
+    }
+    return record;
+}
+
+// 旧版本切块条目的块校验为 zlib CRC32
+uint32_t crc32Of(const std::vector<uint8_t>& data) {
+    uLong crc = ::crc32(0L, Z_NULL, 0);
+    const uint8_t* p = data.data();
+    size_t remaining = data.size();
+    // zlib 的长度参数为 uInt，超大块分段累加
+    while (remaining > 0) {
+        const auto step = static_cast<uInt>(std::min<size_t>(remaining, 1u << 30));
+        crc = ::crc32(crc, p, step);
+        p += step;
+        remaining -= step;
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+// 条目带 CRC32C 标志时核对原始数据；旧版本写入的校验和不可验证，视为通过
+bool plaintextMatches(const ArchiveEntry& entry, const uint8_t* data, size_t size) {
+    return !(entry.flags & MRN_FILE_FLAG_CRC32C) || crc32c(data, size) == entry.checksum;
+}
+
+// 读取切块条目末尾的块表，并核对各块大小与合并后的 CRC 是否与条目一致
+std::vector<BlockRecord> readBlockTable(const ArchiveReader& archive, const ArchiveEntry& entry) {
+    const auto payload = archive.payload(entry);
+    if (payload.size() < 4) {
+        throw std::runtime_error("Truncated blocked entry");
+    }
+    const uint8_t* sizeBytes = payload.end() - 4;
+    const uint32_t tableSize = sizeBytes[0] | (sizeBytes[1] << 8) | (sizeBytes[2] << 16) |
+                               (static_cast<uint32_t>(sizeBytes[3]) << 24);
+    if (tableSize > payload.size() - 4) {
+        throw std::runtime_error("Invalid block table");
+    }
+    const uint64_t tableOffset = entry.fileOffset + entry.compressedSize - 4 - tableSize;
+    const auto table = payload.subview(payload.size() - 4 - tableSize, tableSize);
+
+    size_t pos = 0;
+    const uint64_t blockCount = readVarint(table.data(), table.size(), pos);
+    std::vector<BlockRecord> records;
+    uint64_t blockOffset = entry.fileOffset;
+    uint64_t total = 0;
+    const bool castagnoli = (entry.flags & MRN_FILE_FLAG_CRC32C) != 0;
+    uint32_t combinedCrc = 0;
+    for (uint64_t i = 0; i < blockCount; ++i) {
+        BlockRecord record = readBlockRecord(table, pos);
+        if (record.compressedSize > tableOffset - blockOffset) {
+            throw std::runtime_error("Block out of range");
+        }
+        record.offset = blockOffset;
+        blockOffset += record.compressedSize;
+        total += record.uncompressedSize;
+        combinedCrc = castagnoli ? crc32cCombine(combinedCrc, record.crc, record.uncompressedSize)
+                                 : static_cast<uint32_t>(::crc32_combine(
+                                       combinedCrc, record.crc, static_cast<z_off_t>(record.uncompressedSize)));
+        records.push_back(std::move(record));
+    }
+    if (total != entry.uncompressedSize || combinedCrc != entry.checksum) {
+        throw std::runtime_error("Block table does not match entry checksum");
+    }
+    return records;
+}
+
+// 解压时限制在途数据量：已读入的负载与待写出的原始数据合计不超过上限；
+// 单个任务超过上限时仍允许独占执行
+class ExtractionBudget {
+public:
+    explicit ExtractionBudget(uint64_t limit) : limit_(limit) {}
+
+    void acquire(uint64_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        released_.wait(lock, [&] { return used_ == 0 || used_ + bytes <= limit_; });
+        used_ += bytes;
+    }
+
+    void release(uint64_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            used_ -= bytes;
+        }
+        released_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable released_;
+    uint64_t limit_;
+    uint64_t used_ = 0;
+};
+
+// 固实模式下单个文件不超过该大小才并入块
+constexpr uint64_t kSolidFileLimit = 256 * 1024;
+
+// 按块条目序号归集固实成员；成员引用的块不存在时抛出异常
+std::vector<std::vector<uint32_t>> collectSolidMembers(const std::vector<ArchiveEntry>& entries) {
+    std::vector<std::vector<uint32_t>> members(entries.size());
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].entryType != MRN_ENTRY_SOLID_MEMBER) {
+            continue;
+        }
+        const uint32_t block = entries[i].solidBlock;
+        if (block >= entries.size() || entries[block].entryType != MRN_ENTRY_SOLID_BLOCK) {
+            throw std::runtime_error("Solid member " + entries[i].name +
+                                     " references an invalid block");
+        }
+        members[block].push_back(i);
+    }
+    return members;
+}
+
+bool isGlobPattern(const std::string& pattern) {
+    return pattern.find_first_of("*?[") != std::string::npos;
+}
+
+// 选出与路径或通配符匹配的条目，并带上固实成员所在的块条目（块序号改为在结果中的位置）。
+// 不含通配符的完整路径经名称索引查找，只读取命中条目所在的目录页；
+// 通配符（* 可跨越 /）与目录前缀需要遍历全部条目。有路径为空或不匹配任何条目时抛出异常
+ArchiveDirectory selectEntries(DirectoryReader& reader, const std::vector<std::string>& patterns) {
+    std::vector<uint32_t> selected;
+    std::vector<std::string> scanPatterns;
+    for (const auto& pattern : patterns) {
+        // 空路径不对应任何条目，作为前缀时却会匹配全部条目
+        if (pattern.empty()) {
+            throw std::runtime_error("Empty path in entry selection");
+        }
+        uint32_t index = 0;
+        if (!isGlobPattern(pattern) && reader.find(pattern, index)) {
+            selected.push_back(index);
+        } else {
+            scanPatterns.push_back(pattern);
+        }
+    }
+
+    std::vector<ArchiveEntry> all;
+    if (!scanPatterns.empty()) {
+        all = reader.readAll();
+        for (const auto& pattern : scanPatterns) {
+            const std::string prefix = pattern.back() == '/' ? pattern : pattern + "/";
+            bool matched = false;
+            for (uint32_t i = 0; i < all.size(); ++i) {
+                const auto& name = all[i].name;
+                if (all[i].entryType != MRN_ENTRY_SOLID_BLOCK &&
+                    (::fnmatch(pattern.c_str(), name.c_str(), 0) == 0 || name.compare(0, prefix.size(), prefix) == 0)) {
+                    selected.push_back(i);
+                    matched = true;
+                }
+            }
+            if (!matched) {
+                throw std::runtime_error("Not found in archive: " + pattern);
+            }
+        }
+    }
+    auto entryAt = [&](uint32_t index) -> const ArchiveEntry& {
+        return all.empty() ? reader.entry(index) : all.at(index);
+    };
+
+    std::sort(selected.begin(), selected.end());
+    selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+    ArchiveDirectory result;
+    result.header = reader.header();
+    std::map<uint32_t, uint32_t> blocks;
+    for (uint32_t index : selected) {
+        ArchiveEntry entry = entryAt(index);
+        if (entry.entryType == MRN_ENTRY_SOLID_MEMBER) {
+            auto it = blocks.find(entry.solidBlock);
+            if (it == blocks.end()) {
+                const auto& block = entryAt(entry.solidBlock);
+                if (block.entryType != MRN_ENTRY_SOLID_BLOCK) {
+                    throw std::runtime_error("Solid member " + entry.name + " references an invalid block");
+                }
+                it = blocks.emplace(entry.solidBlock, static_cast<uint32_t>(result.entries.size())).first;
+                result.entries.push_back(block);
+            }
+            entry.solidBlock = it->second;
+        }
+        result.entries.push_back(std::move(entry));
+    }
+    return result;
+}
+
+// 条目阶段标志的简写：M=Move 优化，L=LZ，E=熵编码，stored=原样存储
+std::string describeStages(uint8_t flags) {
+    if (flags & MRN_FILE_FLAG_CHUNKED) {
+        return "chunked";
+    }
+    if (flags & MRN_FILE_FLAG_BLOCKED) {
+        return "blocked";
+    }
+    if (!(flags & MRN_FILE_FLAG_COMPRESSED)) {
+        return "stored";
+    }
+    std::string stages;
+    if (flags & MRN_FILE_FLAG_STAGE_MOVE) {
+        stages += 'M';
+    }
+    if (flags & MRN_FILE_FLAG_STAGE_LZ) {
+        stages += 'L';
+    }
+    if (flags & MRN_FILE_FLAG_STAGE_ENTROPY) {
+        stages += 'E';
+    }
+    if (flags & MRN_FILE_FLAG_DICTIONARY) {
+        stages += 'D';
+    }
+    return stages.empty() ? "-" : stages;
 }
 
 void logCompressionStats(const std::string& label,
@@ -67,17 +429,47 @@ CompressionResult ModularCompressor::compressFile(const std::string& inputFile,
                                                   const std::string& outputFile,
                                                   const CompressionPipeline& pipeline,
                                                   const CompressionOptions& options) {
-    // 使用归档格式，保持与目录压缩一致
-    ArchiveWriter writer(outputFile, pipeline);
-    
     std::filesystem::path inputPath(inputFile);
     std::string archivePath = inputPath.filename().string();
+
+    // 增量归档：参照归档在写入器之前打开（写入器持有输出归档的排他锁）
+    std::unordered_map<std::string, ArchiveEntry> referenceEntries;
+    const auto reference =
+        options.referenceArchive.empty() ? nullptr : openReference(options.referenceArchive, outputFile, referenceEntries);
+
+    // 使用归档格式，保持与目录压缩一致
+    ArchiveWriter writer(outputFile, pipeline);
+
+    // 与目录压缩相同的判定：同名条目大小与修改时间（及要求时的内容校验和）都未变时原样复制。
+    // 单文件归档没有共享字典，以字典压缩的条目不能复制
+    if (reference) {
+        DirectoryScanner::FileInfo file;
+        file.path = inputFile;
+        file.relativePath = archivePath;
+        file.size = std::filesystem::file_size(inputPath);
+        file.modifiedTime = FileIO::modifiedTime(inputFile);
+        const auto* entry = findUnchanged(referenceEntries, file, false, options.referenceVerifyHash);
+        if (entry && (!options.referenceVerifyHash || FileIO::checksumFile(inputFile) == entry->checksum)) {
+            writer.copyEntry(*entry, reference->payload(*entry));
+            writer.finalize();
+            Logger::instance().log(Logger::Level::Info, "增量: 从参照归档复制 1 个未变条目，共 " +
+                                                            std::to_string(entry->compressedSize) + " bytes");
+            CompressionResult aggregated;
+            aggregated.uncompressedSize = entry->uncompressedSize;
+            return aggregated;
+        }
+    }
     
-    auto result = compressSingleFile(inputFile, archivePath, pipeline, options);
+    // 大文件切块并行压缩，不必整体读入内存
+    const bool split = options.splitBlockSize > 0 && !options.skipCompression &&
+                       std::filesystem::file_size(inputPath) > options.splitBlockSize;
+    auto result = split ? compressBlockedFile(inputFile, archivePath, pipeline, options, writer)
+                        : compressSingleFile(inputFile, archivePath, pipeline, options);
     writer.addCompressedFile(result);
     writer.finalize();
     
-    logCompressionStats(inputFile, result.result.uncompressedSize, result.result.compressedData.size());
+    logCompressionStats(inputFile, result.result.uncompressedSize,
+                        result.blockBytes + result.result.compressedData.size());
     
     CompressionResult aggregated;
     aggregated.compressedData = result.result.compressedData;
@@ -85,10 +477,94 @@ CompressionResult ModularCompressor::compressFile(const std::string& inputFile,
     return aggregated;
 }
 
+CompressionResult ModularCompressor::compressStream(std::istream& input,
+                                                    const std::string& entryName,
+                                                    const std::string& outputFile,
+                                                    const CompressionPipeline& pipeline,
+                                                    const CompressionOptions& options) {
+    ArchiveWriter writer(outputFile, pipeline);
+
+    FileCompressionResult result;
+    result.originalPath = entryName;
+    result.archivePath = entryName;
+    result.streamed = true;
+    result.compressionLevel = static_cast<uint8_t>(std::min(std::max(options.compressionLevel, 0), 255));
+    result.payloadOffset = writer.writeBlob({});
+
+    // 预处理器需要完整输入，流式压缩只执行主算法
+    std::unique_ptr<ICompressionStream> stream;
+    std::vector<uint8_t> output;
+    if (!options.skipCompression) {
+        auto algorithm = pluginManager_.getAlgorithm(pipeline.mainAlgorithm);
+        if (!algorithm) {
+            throw std::runtime_error("Algorithm not found: " + pipeline.mainAlgorithm);
+        }
+        if (!algorithm->getCapabilities().supportsStreaming) {
+            throw std::runtime_error("Algorithm does not support streaming: " + pipeline.mainAlgorithm);
+        }
+        stream = algorithm->beginStream(buildParams(pipeline, options), output);
+        recordAlgorithm(pipeline, *algorithm, result);
+    }
+
+    // 输出攒在缓冲区中，每读一段输入就写出并清空；校验和随读入分段累计
+    uint32_t checksum = 0;
+    uint64_t totalSize = 0;
+    std::vector<uint8_t> chunk(kStreamReadSize);
+    while (input) {
+        input.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        const auto size = static_cast<size_t>(input.gcount());
+        if (size == 0) {
+            break;
+        }
+        totalSize += size;
+        checksum = crc32c(chunk.data(), size, checksum);
+        if (stream) {
+            stream->feed(chunk.data(), size, output);
+        } else {
+            output.insert(output.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(size));
+        }
+        if (!output.empty()) {
+            writer.writeBlob(output);
+            result.blockBytes += output.size();
+            output.clear();
+        }
+    }
+    if (input.bad()) {
+        throw std::runtime_error("Failed to read input stream: " + entryName);
+    }
+
+    if (stream) {
+        result.result = stream->finish(output);
+    } else {
+        result.result.uncompressedSize = totalSize;
+        result.result.isCompressed = false;
+    }
+    result.checksum = checksum;
+    result.result.compressedData = std::move(output);
+    writer.addCompressedFile(result);
+    writer.finalize();
+
+    logCompressionStats(entryName, result.result.uncompressedSize,
+                        result.blockBytes + result.result.compressedData.size());
+
+    CompressionResult aggregated;
+    aggregated.uncompressedSize = result.result.uncompressedSize;
+    return aggregated;
+}
+
 CompressionResult ModularCompressor::compressDirectory(const std::string& inputDir,
                                                        const std::string& outputFile,
                                                        const CompressionPipeline& pipeline,
                                                        const CompressionOptions& options) {
+    // 增量归档：读入参照归档的目录，只保留负载可以原样复制的普通条目
+    std::unique_ptr<ArchiveReader> reference;
+    std::unordered_map<std::string, ArchiveEntry> referenceEntries;
+    std::vector<uint8_t> referenceDictionary;
+    if (!options.referenceArchive.empty()) {
+        reference = openReference(options.referenceArchive, outputFile, referenceEntries);
+        referenceDictionary = reference->dictionary().toVector();
+    }
+
     ArchiveWriter writer(outputFile, pipeline);
     auto files = directoryScanner_->scanDirectory(inputDir, options.scanOptions);
 
@@ -101,14 +577,189 @@ CompressionResult ModularCompressor::compressDirectory(const std::string& inputD
     }
 
     // 多线程压缩，每个文件根据类型自动选择最佳预设
-    std::vector<std::future<FileCompressionResult>> futures;
-    bool useAutoPreset = (options.verbose || true); // 总是为每个文件检测最佳预设
+    const bool useAutoPreset = options.autoDetectPreset;
+    const bool solid = options.solidBlockSize > 0;
+    if (solid && options.dedup) {
+        throw std::runtime_error("Solid mode cannot be combined with dedup");
+    }
+    auto chunkStore = options.dedup ? std::make_unique<ChunkStore>() : nullptr;
+    ChunkStore* store = chunkStore.get();
+    // 固实块已为小文件提供上下文，不再训练共享字典。
+    // 参照归档带有共享字典时沿用该字典，以它压缩的未变条目才能原样复制
+    const bool inheritDictionary = !referenceDictionary.empty() && options.trainDictionary &&
+                                   options.dictionaryName.empty() && options.saveDictionaryName.empty();
+    const auto dictionary = solid               ? std::vector<uint8_t>()
+                            : inheritDictionary ? referenceDictionary
+                                                : prepareDictionary(fileList, pipeline, options);
+    const bool dictionaryMatches = !dictionary.empty() && dictionary == referenceDictionary;
+    if (!dictionary.empty()) {
+        writer.setDictionary(dictionary);
+    }
+    const std::vector<uint8_t>* sharedDictionary = &dictionary;
+
+    // 按提交顺序写入归档；每项是单个文件、一个固实块或一个待切块的大文件
+    struct PendingJob {
+        std::future<FileCompressionResult> file;
+        std::future<SolidBlockResult> block;
+        const DirectoryScanner::FileInfo* largeFile = nullptr;
+        // 增量归档：参照归档中可复制的条目。核对内容时，大文件由 unchanged 给出 CRC32C 是否一致，
+        // 不一致时照常切块压缩 largeFile；其余文件在线程池上核对，不一致时接着压缩，
+        // recompressed 给出压缩结果，一致时为空
+        const ArchiveEntry* reference = nullptr;
+        std::future<bool> unchanged;
+        std::future<std::optional<FileCompressionResult>> recompressed;
+    };
+    std::vector<PendingJob> jobs;
+
+    // 固实模式：小文件按预设分组，组内依次拼接，达到块大小即提交一个块
+    struct SolidGroup {
+        CompressionPreset preset;
+        std::vector<DirectoryScanner::FileInfo> files;
+        uint64_t bytes = 0;
+    };
+    std::map<std::string, SolidGroup> solidGroups;
+    auto flushGroup = [&](SolidGroup& group) {
+        if (group.files.empty()) {
+            return;
+        }
+        PendingJob job;
+        job.block = threadPool_->enqueue([this, files = std::move(group.files), preset = group.preset] {
+            return compressSolidBlock(files, preset.pipeline, preset.options);
+        });
+        jobs.push_back(std::move(job));
+        group.files.clear();
+        group.bytes = 0;
+    };
+    const uint64_t solidFileLimit = std::min<uint64_t>(kSolidFileLimit, options.solidBlockSize);
+
+    auto compressOne = [this, pipeline, options, useAutoPreset, store,
+                        sharedDictionary](const DirectoryScanner::FileInfo& file) {
+        CompressionPipeline filePipeline = pipeline;
+        CompressionOptions fileOptions = options;
+        
+        // 为每个文件检测最佳预设（智能文件类型优化）
+        if (useAutoPreset) {
+            ConfigurationManager configMgr;
+            CompressionPreset preset = configMgr.detectBestPreset(file.path);
+            filePipeline = preset.pipeline;
+            fileOptions = preset.options;
+            fileOptions.verbose = options.verbose;
+            fileOptions.overwrite = options.overwrite;
+            fileOptions.raceObjective = options.raceObjective;
+            fileOptions.raceSizeBound = options.raceSizeBound;
+        }
+        
+        if (store) {
+            return compressChunkedFile(file.path, file.relativePath, filePipeline, fileOptions, *store,
+                                       sharedDictionary);
+        }
+        return compressSingleFile(file.path, file.relativePath, filePipeline, fileOptions,
+                                  sharedDictionary);
+    };
+
     for (const auto& file : fileList) {
-        futures.push_back(threadPool_->enqueue([this, file, pipeline, options, useAutoPreset] {
+        const bool large = !store && options.splitBlockSize > 0 && file.size > options.splitBlockSize;
+        if (const auto* reference = findUnchanged(referenceEntries, file, dictionaryMatches,
+                                                  options.referenceVerifyHash)) {
+            PendingJob job;
+            job.reference = reference;
+            if (options.referenceVerifyHash && large) {
+                job.largeFile = &file;
+                job.unchanged = threadPool_->enqueue([path = file.path, checksum = reference->checksum] {
+                    return FileIO::checksumFile(path) == checksum;
+                });
+            } else if (options.referenceVerifyHash) {
+                job.recompressed = threadPool_->enqueue(
+                    [compressOne, file, checksum = reference->checksum]() -> std::optional<FileCompressionResult> {
+                        if (FileIO::checksumFile(file.path) == checksum) {
+                            return std::nullopt;
+                        }
+                        return compressOne(file);
+                    });
+            }
+            jobs.push_back(std::move(job));
+            continue;
+        }
+
+        if (solid && file.size <= solidFileLimit) {
+            CompressionPreset preset;
+            preset.name = "default";
+            preset.pipeline = pipeline;
+            preset.options = options;
+            if (useAutoPreset) {
+                ConfigurationManager configMgr;
+                preset = configMgr.detectBestPreset(file.path);
+            }
+            auto& group = solidGroups[preset.name];
+            if (group.files.empty()) {
+                group.preset = preset;
+            } else if (group.bytes + file.size > options.solidBlockSize) {
+                flushGroup(group);
+            }
+            group.files.push_back(file);
+            group.bytes += file.size;
+            continue;
+        }
+
+        // 大文件轮到写出时由主线程切块：各块在线程池上压缩并直接写入归档，
+        // 条目可按块随机读取，内存占用与文件大小无关
+        if (large) {
+            PendingJob job;
+            job.largeFile = &file;
+            jobs.push_back(std::move(job));
+            continue;
+        }
+
+        PendingJob job;
+        job.file = threadPool_->enqueue([compressOne, file] { return compressOne(file); });
+        jobs.push_back(std::move(job));
+    }
+    for (auto& [name, group] : solidGroups) {
+        flushGroup(group);
+    }
+
+    // 收集结果并写入归档
+    CompressionResult aggregated;
+    uint64_t totalCompressedSize = 0;
+    uint64_t reusedEntries = 0;
+    uint64_t reusedBytes = 0;
+    for (auto& job : jobs) {
+        std::optional<FileCompressionResult> recompressed;
+        if (job.recompressed.valid()) {
+            recompressed = job.recompressed.get();
+        }
+        if (job.reference && !recompressed && (!job.unchanged.valid() || job.unchanged.get())) {
+            writer.copyEntry(*job.reference, reference->payload(*job.reference));
+            aggregated.uncompressedSize += job.reference->uncompressedSize;
+            totalCompressedSize += job.reference->compressedSize;
+            ++reusedEntries;
+            reusedBytes += job.reference->compressedSize;
+            continue;
+        }
+
+        if (job.block.valid()) {
+            auto solidResult = job.block.get();
+            const uint32_t blockIndex = writer.entryCount();
+            writer.addCompressedFile(solidResult.block);
+            for (auto& member : solidResult.members) {
+                member.solidBlock = blockIndex;
+                writer.addCompressedFile(member);
+            }
+            aggregated.uncompressedSize += solidResult.block.result.uncompressedSize;
+            totalCompressedSize += solidResult.block.result.compressedData.size();
+            logCompressionStats("[solid block: " + std::to_string(solidResult.members.size()) + " files]",
+                                solidResult.block.result.uncompressedSize,
+                                solidResult.block.result.compressedData.size());
+            continue;
+        }
+
+        FileCompressionResult result;
+        if (recompressed) {
+            result = std::move(*recompressed);
+        } else if (job.largeFile) {
+            const auto& file = *job.largeFile;
             CompressionPipeline filePipeline = pipeline;
             CompressionOptions fileOptions = options;
-            
-            // 为每个文件检测最佳预设（智能文件类型优化）
             if (useAutoPreset) {
                 ConfigurationManager configMgr;
                 CompressionPreset preset = configMgr.detectBestPreset(file.path);
@@ -116,25 +767,37 @@ CompressionResult ModularCompressor::compressDirectory(const std::string& inputD
                 fileOptions = preset.options;
                 fileOptions.verbose = options.verbose;
                 fileOptions.overwrite = options.overwrite;
+                fileOptions.raceObjective = options.raceObjective;
+                fileOptions.raceSizeBound = options.raceSizeBound;
+                fileOptions.splitBlockSize = options.splitBlockSize;
             }
-            
-            return compressSingleFile(file.path, file.relativePath, filePipeline, fileOptions);
-        }));
-    }
-
-    // 收集结果并写入归档
-    CompressionResult aggregated;
-    uint64_t totalCompressedSize = 0;
-    for (size_t i = 0; i < futures.size(); ++i) {
-        auto result = futures[i].get();
+            // 与单文件压缩一致：只存储的文件保持普通条目，本身即可按偏移直接读取
+            result = fileOptions.skipCompression
+                         ? compressSingleFile(file.path, file.relativePath, filePipeline, fileOptions)
+                         : compressBlockedFile(file.path, file.relativePath, filePipeline, fileOptions, writer);
+        } else {
+            result = job.file.get();
+        }
+        if (result.chunked) {
+            resolveChunkRefs(writer, *store, result);
+        }
         writer.addCompressedFile(result);
         aggregated.compressedData.insert(aggregated.compressedData.end(),
                                          result.result.compressedData.begin(),
                                          result.result.compressedData.end());
         aggregated.uncompressedSize += result.result.uncompressedSize;
-        totalCompressedSize += result.result.compressedData.size();
-        logCompressionStats(result.archivePath, result.result.uncompressedSize,
-                            result.result.compressedData.size());
+        // 切块文件的块数据已直接写入归档，compressedData 只是块表
+        const uint64_t compressedBytes = result.blockBytes + result.result.compressedData.size();
+        totalCompressedSize += compressedBytes;
+        logCompressionStats(result.archivePath, result.result.uncompressedSize, compressedBytes);
+    }
+    if (store) {
+        Logger::instance().log(Logger::Level::Info,
+                               "去重: " + std::to_string(store->uniqueChunks()) + " 个唯一块");
+    }
+    if (!options.referenceArchive.empty()) {
+        Logger::instance().log(Logger::Level::Info, "增量: 从参照归档复制 " + std::to_string(reusedEntries) +
+                                                        " 个未变条目，共 " + std::to_string(reusedBytes) + " bytes");
     }
     logCompressionStats("TOTAL", aggregated.uncompressedSize, totalCompressedSize);
 
@@ -142,78 +805,274 @@ CompressionResult ModularCompressor::compressDirectory(const std::string& inputD
     return aggregated;
 }
 
-DecompressionResult ModularCompressor::decompress(const std::string& inputFile,
-                                                  const std::string& outputPath) {
-    std::ifstream archive(inputFile, std::ios::binary);
-    if (!archive) {
-        throw std::runtime_error("Failed to open archive: " + inputFile);
-    }
-
-    MRNArchiveHeader header{};
-    archive.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!archive || !validateHeader(header)) {
-        throw std::runtime_error("Invalid MRN archive: " + inputFile);
+CompressionResult ModularCompressor::append(const std::string& archiveFile,
+                                           const std::vector<std::string>& inputPaths,
+                                           const CompressionPipeline& pipeline,
+                                           const CompressionOptions& options) {
+    std::vector<DirectoryScanner::FileInfo> files;
+    for (const auto& inputPath : inputPaths) {
+        if (std::filesystem::is_directory(inputPath)) {
+            for (auto& file : directoryScanner_->scanDirectory(inputPath, options.scanOptions)) {
+                if (!file.isDirectory) {
+                    files.push_back(std::move(file));
+                }
+            }
+        } else if (std::filesystem::is_regular_file(inputPath)) {
+            DirectoryScanner::FileInfo file;
+            file.path = inputPath;
+            file.relativePath = std::filesystem::path(inputPath).filename().string();
+            file.size = std::filesystem::file_size(inputPath);
+            files.push_back(std::move(file));
+        } else {
+            throw std::runtime_error("Input path is neither a file nor a directory: " + inputPath);
+        }
     }
 
-    auto algorithm = pluginManager_.getAlgorithm(defaultPipeline_.mainAlgorithm);
-    if (!algorithm) {
-        throw std::runtime_error("Default algorithm not registered");
+    // 归档改动之前检查重名，同名条目会让按路径查找变得不确定
+    {
+        ArchiveReader archive(archiveFile);
+        archive.advise(ArchiveReader::Access::Random);
+        auto& reader = archive.directory();
+        std::set<std::string> names;
+        for (const auto& file : files) {
+            uint32_t index = 0;
+            if (!names.insert(file.relativePath).second || reader.find(file.relativePath, index)) {
+                throw std::runtime_error("Already in archive: " + file.relativePath);
+            }
+        }
     }
 
-    const auto entriesOffset =
-        static_cast<std::streamoff>(sizeof(MRNArchiveHeader) + header.totalCompressedSize);
-
-    std::filesystem::create_directories(outputPath);
+    ArchiveWriter writer(archiveFile, pipeline, ArchiveWriter::OpenMode::Append);
+    // 与目录压缩一致：自动预设时按每个文件的类型选择预设
+    auto applyPreset = [&](const DirectoryScanner::FileInfo& file, CompressionPipeline& filePipeline,
+                           CompressionOptions& fileOptions) {
+        if (!options.autoDetectPreset) {
+            return;
+        }
+        ConfigurationManager configMgr;
+        CompressionPreset preset = configMgr.detectBestPreset(file.path);
+        filePipeline = preset.pipeline;
+        fileOptions = preset.options;
+        fileOptions.verbose = options.verbose;
+        fileOptions.overwrite = options.overwrite;
+        fileOptions.splitBlockSize = options.splitBlockSize;
+        fileOptions.raceObjective = options.raceObjective;
+        fileOptions.raceSizeBound = options.raceSizeBound;
+    };
 
-    for (uint32_t i = 0; i < header.fileCount; ++i) {
-        FileEntryHeader entry{};
-        archive.seekg(entriesOffset + static_cast<std::streamoff>(i * sizeof(FileEntryHeader)),
-                      std::ios::beg);
-        archive.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        if (!archive) {
-            throw std::runtime_error("Failed to read file entry " + std::to_string(i));
+    // 小文件在线程池上压缩，大文件在写入时切块并行压缩；按提交顺序写入
+    std::vector<std::future<FileCompressionResult>> jobs(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (options.splitBlockSize > 0 && files[i].size > options.splitBlockSize) {
+            continue;
         }
+        jobs[i] = threadPool_->enqueue([this, &file = files[i], &applyPreset, pipeline, options] {
+            auto jobPipeline = pipeline;
+            auto jobOptions = options;
+            applyPreset(file, jobPipeline, jobOptions);
+            return compressSingleFile(file.path, file.relativePath, jobPipeline, jobOptions);
+        });
+    }
 
-        std::vector<uint8_t> compressed(entry.compressedSize);
-        archive.seekg(static_cast<std::streamoff>(entry.fileOffset), std::ios::beg);
-        archive.read(reinterpret_cast<char*>(compressed.data()), entry.compressedSize);
-        if (!archive) {
-            throw std::runtime_error("Failed to read file data for entry " + std::to_string(i));
+    CompressionResult aggregated;
+    uint64_t totalCompressedSize = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        FileCompressionResult result;
+        if (jobs[i].valid()) {
+            result = jobs[i].get();
+        } else {
+            auto largePipeline = pipeline;
+            auto largeOptions = options;
+            applyPreset(files[i], largePipeline, largeOptions);
+            result = largeOptions.skipCompression
+                         ? compressSingleFile(files[i].path, files[i].relativePath, largePipeline, largeOptions)
+                         : compressBlockedFile(files[i].path, files[i].relativePath, largePipeline, largeOptions,
+                                               writer);
         }
+        writer.addCompressedFile(result);
+        aggregated.uncompressedSize += result.result.uncompressedSize;
+        const uint64_t compressedBytes = result.blockBytes + result.result.compressedData.size();
+        totalCompressedSize += compressedBytes;
+        logCompressionStats(result.archivePath, result.result.uncompressedSize, compressedBytes);
+    }
+    logCompressionStats("TOTAL", aggregated.uncompressedSize, totalCompressedSize);
+
+    writer.finalize();
+    return aggregated;
+}
+
+DecompressionResult ModularCompressor::decompress(const std::string& inputFile,
+                                                  const std::string& outputPath,
+                                                  const std::vector<std::string>& selection) {
+    ArchiveReader archive(inputFile);
+    // 完整解压按偏移顺序读遍整个数据区；只解出部分条目时读取是零散的，不必预读
+    archive.advise(selection.empty() ? ArchiveReader::Access::Sequential : ArchiveReader::Access::Random);
+    ArchiveDirectory directory;
+    if (selection.empty()) {
+        directory.header = archive.header();
+        directory.entries = archive.entries();
+    } else {
+        directory = selectEntries(archive.directory(), selection);
+    }
+    const auto& entries = directory.entries;
 
-        DecompressParams params;
-        params.expectedSize = entry.uncompressedSize;
-        params.dataIsCompressed = (entry.flags & MRN_FILE_FLAG_COMPRESSED) != 0;
-        auto fileResult = algorithm->decompress(params, compressed);
+    std::filesystem::create_directories(outputPath);
+    const auto dictionary = archive.dictionary().toVector();
+    const auto solidMembers = collectSolidMembers(entries);
 
-        const std::filesystem::path outputFile = std::filesystem::path(outputPath) / entry.filename;
+    auto prepareOutput = [&](const ArchiveEntry& entry) {
+        const std::filesystem::path outputFile = std::filesystem::path(outputPath) / entry.name;
         std::filesystem::create_directories(outputFile.parent_path());
-        FileIO::writeFile(outputFile.string(), fileResult.decompressedData);
-        
+        return outputFile;
+    };
+    auto restorePermissions = [](const ArchiveEntry& entry, const std::filesystem::path& outputFile) {
         // 恢复文件权限
         if (entry.permissions != 0) {
             std::filesystem::permissions(outputFile, 
                 static_cast<std::filesystem::perms>(entry.permissions));
         }
+    };
+
+    // 解压计划：按数据在归档中的位置排序，主线程按序分发负载视图，解码与写出交给线程池
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        // 固实成员随所在块一起解出
+        if (entries[i].entryType != MRN_ENTRY_SOLID_MEMBER) {
+            order.push_back(i);
+        }
     }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return entries[a].fileOffset < entries[b].fileOffset;
+    });
 
-    return {};
-}
+    ExtractionBudget budget(extractMemoryBudget_);
+    std::vector<std::future<void>> tasks;
+    auto submit = [&](uint64_t cost, std::function<void()> work) {
+        budget.acquire(cost);
+        tasks.push_back(threadPool_->enqueue([&budget, cost, work = std::move(work)] {
+            struct Release {
+                ExtractionBudget& budget;
+                uint64_t cost;
+                ~Release() { budget.release(cost); }
+            } release{budget, cost};
+            work();
+        }));
+    };
 
-void ModularCompressor::listArchive(const std::string& inputFile) {
-    std::ifstream archive(inputFile, std::ios::binary);
-    if (!archive) {
-        throw std::runtime_error("Failed to open archive: " + inputFile);
+    const std::vector<uint8_t>* sharedDictionary = &dictionary;
+    std::vector<std::pair<uint32_t, std::filesystem::path>> blockedOutputs;
+    try {
+        for (uint32_t i : order) {
+            const auto& entry = entries[i];
+
+            // 切块条目按块分发：各块解码后写到输出文件中各自的偏移处
+            if (entry.flags & MRN_FILE_FLAG_BLOCKED) {
+                const auto outputFile = prepareOutput(entry);
+                {
+                    std::ofstream output(outputFile, std::ios::binary | std::ios::trunc);
+                    if (!output) {
+                        throw std::runtime_error("Failed to write file: " + outputFile.string());
+                    }
+                }
+                std::filesystem::resize_file(outputFile, entry.uncompressedSize);
+                blockedOutputs.emplace_back(i, outputFile);
+
+                uint64_t outputOffset = 0;
+                for (auto& record : readBlockTable(archive, entry)) {
+                    const auto payload = archive.view(record.offset, record.compressedSize);
+                    submit(record.compressedSize + record.uncompressedSize,
+                           [this, &entry, record, payload, outputFile, outputOffset] {
+                               PipelineExecutor blockExecutor(pluginManager_);
+                               const auto block = decodeBlock(entry, record, payload, blockExecutor);
+                               std::fstream output(outputFile, std::ios::binary | std::ios::in | std::ios::out);
+                               output.seekp(static_cast<std::streamoff>(outputOffset), std::ios::beg);
+                               output.write(reinterpret_cast<const char*>(block.data()),
+                                            static_cast<std::streamsize>(block.size()));
+                               if (!output) {
+                                   throw std::runtime_error("Failed to write file: " + outputFile.string());
+                               }
+                           });
+                    outputOffset += record.uncompressedSize;
+                }
+                continue;
+            }
+
+            // 输出目录由主线程预先创建，工作线程只写文件
+            std::vector<std::pair<ArchiveEntry, std::filesystem::path>> outputs;
+            if (entry.entryType == MRN_ENTRY_SOLID_BLOCK) {
+                for (uint32_t memberIndex : solidMembers[i]) {
+                    outputs.emplace_back(entries[memberIndex], prepareOutput(entries[memberIndex]));
+                }
+            } else {
+                outputs.emplace_back(entry, prepareOutput(entry));
+            }
+
+            const auto payload = archive.payload(entry);
+            submit(entry.compressedSize + entry.uncompressedSize,
+                   [this, &archive, sharedDictionary, entry, payload, outputs = std::move(outputs),
+                    restorePermissions] {
+                       PipelineExecutor entryExecutor(pluginManager_);
+                       // 原样存储的条目直接从映射写出；分块条目经 archive 按引用取块
+                       std::vector<uint8_t> decoded;
+                       const auto restored = restoreEntry(entry, payload, entryExecutor, &archive,
+                                                          sharedDictionary, decoded);
+                       if (entry.entryType == MRN_ENTRY_FILE) {
+                           FileIO::writeFile(outputs.front().second.string(), restored);
+                           restorePermissions(entry, outputs.front().second);
+                           return;
+                       }
+
+                       // 每个块只解压一次，再按偏移分发给各成员
+                       for (const auto& [member, outputFile] : outputs) {
+                           if (member.fileOffset > restored.size() ||
+                               member.uncompressedSize > restored.size() - member.fileOffset) {
+                               throw std::runtime_error("Solid member out of range: " + member.name);
+                           }
+                           if (!plaintextMatches(member, restored.data() + member.fileOffset,
+                                                 member.uncompressedSize)) {
+                               throw std::runtime_error("Checksum mismatch: " + member.name);
+                           }
+                           FileIO::writeFile(outputFile.string(),
+                                             restored.subview(member.fileOffset, member.uncompressedSize));
+                           restorePermissions(member, outputFile);
+                       }
+                   });
+        }
+    } catch (...) {
+        // 任务引用了本函数的局部对象，须全部结束后才能抛出
+        for (auto& task : tasks) {
+            task.wait();
+        }
+        throw;
     }
 
-    MRNArchiveHeader header{};
-    archive.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!archive || !validateHeader(header)) {
-        throw std::runtime_error("Invalid MRN archive: " + inputFile);
+    std::exception_ptr firstError;
+    for (auto& task : tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    // 切块文件的全部块写完后再设置权限，避免只读权限阻止后续块写入
+    for (const auto& [index, outputFile] : blockedOutputs) {
+        restorePermissions(entries[index], outputFile);
     }
 
-    const auto entriesOffset =
-        static_cast<std::streamoff>(sizeof(MRNArchiveHeader) + header.totalCompressedSize);
+    return {};
+}
+
+void ModularCompressor::listArchive(const std::string& inputFile) {
+    ArchiveReader archive(inputFile);
+    // 只读取目录
+    archive.advise(ArchiveReader::Access::Random);
+    const auto& header = archive.header();
+    const auto& entries = archive.entries();
 
     std::cout << "MRN Archive: " << inputFile << std::endl;
     std::cout << "Version: " << static_cast<int>(header.version) << std::endl;
@@ -230,94 +1089,122 @@ void ModularCompressor::listArchive(const std::string& inputFile) {
     std::cout << std::left << std::setw(40) << "Filename" 
               << std::right << std::setw(12) << "Original" 
               << std::setw(12) << "Compressed" 
-              << std::setw(10) << "Ratio" << std::endl;
-    std::cout << std::string(74, '-') << std::endl;
+              << std::setw(10) << "Ratio"
+              << std::setw(7) << "Level"
+              << std::setw(8) << "Stages" << std::endl;
+    std::cout << std::string(89, '-') << std::endl;
 
     for (uint32_t i = 0; i < header.fileCount; ++i) {
-        FileEntryHeader entry{};
-        archive.seekg(entriesOffset + static_cast<std::streamoff>(i * sizeof(FileEntryHeader)),
-                      std::ios::beg);
-        archive.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        if (!archive) {
-            throw std::runtime_error("Failed to read file entry " + std::to_string(i));
-        }
-
-        std::string filename(entry.filename);
+        const auto& entry = entries[i];
+        std::string filename = entry.name;
         double ratio = entry.uncompressedSize > 0
                            ? (1.0 - static_cast<double>(entry.compressedSize) /
                                         static_cast<double>(entry.uncompressedSize)) * 100.0
                            : 0.0;
 
+        if (entry.entryType == MRN_ENTRY_SOLID_BLOCK) {
+            filename = "[solid block #" + std::to_string(i) + "]";
+        } else if (entry.entryType == MRN_ENTRY_SOLID_MEMBER) {
+            std::cout << std::left << std::setw(40) << filename
+                      << std::right << std::setw(12) << entry.uncompressedSize
+                      << std::setw(12) << "-"
+                      << std::setw(10) << "-"
+                      << std::setw(7) << static_cast<int>(entry.compressionLevel)
+                      << std::setw(8) << ("#" + std::to_string(entry.solidBlock)) << std::endl;
+            continue;
+        }
+
         std::cout << std::left << std::setw(40) << filename
                   << std::right << std::setw(12) << entry.uncompressedSize
                   << std::setw(12) << entry.compressedSize
-                  << std::setw(9) << std::fixed << std::setprecision(2) << ratio << "%" << std::endl;
+                  << std::setw(9) << std::fixed << std::setprecision(2) << ratio << "%"
+                  << std::setw(7) << static_cast<int>(entry.compressionLevel)
+                  << std::setw(8) << describeStages(entry.flags) << std::endl;
     }
 }
 
 bool ModularCompressor::testArchive(const std::string& inputFile) {
-    std::ifstream archive(inputFile, std::ios::binary);
-    if (!archive) {
-        std::cerr << "Error: Failed to open archive: " << inputFile << std::endl;
-        return false;
-    }
-
-    MRNArchiveHeader header{};
-    archive.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!archive || !validateHeader(header)) {
-        std::cerr << "Error: Invalid MRN archive header" << std::endl;
+    PipelineExecutor executor(pluginManager_);
+    std::unique_ptr<ArchiveReader> archive;
+    std::vector<ArchiveEntry> entries;
+    std::vector<uint8_t> dictionary;
+    try {
+        archive = std::make_unique<ArchiveReader>(inputFile);
+        // 按条目顺序逐一校验，基本是顺序读取
+        archive->advise(ArchiveReader::Access::Sequential);
+        entries = archive->entries();
+        dictionary = archive->dictionary().toVector();
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
         return false;
     }
+    bool allOk = true;
+    std::cout << "Testing archive: " << inputFile << std::endl;
+    std::cout << "Files: " << archive->header().fileCount << std::endl;
 
-    auto algorithm = pluginManager_.getAlgorithm(defaultPipeline_.mainAlgorithm);
-    if (!algorithm) {
-        std::cerr << "Error: Default algorithm not registered" << std::endl;
+    std::vector<std::vector<uint32_t>> solidMembers;
+    try {
+        solidMembers = collectSolidMembers(entries);
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
         return false;
     }
 
-    const auto entriesOffset =
-        static_cast<std::streamoff>(sizeof(MRNArchiveHeader) + header.totalCompressedSize);
-
-    bool allOk = true;
-    std::cout << "Testing archive: " << inputFile << std::endl;
-    std::cout << "Files: " << header.fileCount << std::endl;
-
-    for (uint32_t i = 0; i < header.fileCount; ++i) {
-        FileEntryHeader entry{};
-        archive.seekg(entriesOffset + static_cast<std::streamoff>(i * sizeof(FileEntryHeader)),
-                      std::ios::beg);
-        archive.read(reinterpret_cast<char*>(&entry), sizeof(entry));
-        if (!archive) {
-            std::cerr << "Error: Failed to read file entry " << i << std::endl;
-            allOk = false;
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        const auto& entry = entries[i];
+        if (entry.entryType == MRN_ENTRY_SOLID_MEMBER) {
+            continue;
+        }
+        if (entry.flags & MRN_FILE_FLAG_BLOCKED) {
+            try {
+                decodeBlockedEntry(entry, executor, *archive, [](const std::vector<uint8_t>&) {});
+                std::cout << "OK: " << entry.name << std::endl;
+            } catch (const std::exception& ex) {
+                std::cerr << "Error: Failed to decompress " << entry.name << ": " << ex.what() << std::endl;
+                allOk = false;
+            }
             continue;
         }
 
-        std::vector<uint8_t> compressed(entry.compressedSize);
-        archive.seekg(static_cast<std::streamoff>(entry.fileOffset), std::ios::beg);
-        archive.read(reinterpret_cast<char*>(compressed.data()), entry.compressedSize);
-        if (!archive || archive.gcount() != static_cast<std::streamsize>(entry.compressedSize)) {
-            std::cerr << "Error: Failed to read file data for " << entry.filename << std::endl;
+        ByteView payload;
+        try {
+            payload = archive->payload(entry);
+        } catch (const std::exception&) {
+            std::cerr << "Error: Failed to read file data for " << entry.name << std::endl;
             allOk = false;
             continue;
         }
 
         try {
-            DecompressParams params;
-            params.expectedSize = entry.uncompressedSize;
-            params.dataIsCompressed = (entry.flags & MRN_FILE_FLAG_COMPRESSED) != 0;
-            auto fileResult = algorithm->decompress(params, compressed);
+            std::vector<uint8_t> decoded;
+            const auto restored = restoreEntry(entry, payload, executor, archive.get(), &dictionary, decoded);
 
-            if (fileResult.decompressedData.size() != entry.uncompressedSize) {
-                std::cerr << "Error: Size mismatch for " << entry.filename 
+            if (restored.size() != entry.uncompressedSize) {
+                std::cerr << "Error: Size mismatch for " << entry.name 
                           << " (expected " << entry.uncompressedSize 
-                          << ", got " << fileResult.decompressedData.size() << ")" << std::endl;
+                          << ", got " << restored.size() << ")" << std::endl;
                 allOk = false;
-            } else {
-                std::cout << "OK: " << entry.filename << std::endl;
+            } else if (entry.entryType == MRN_ENTRY_FILE) {
+                std::cout << "OK: " << entry.name << std::endl;
+            }
+            if (entry.entryType != MRN_ENTRY_SOLID_BLOCK) {
+                continue;
+            }
+            for (uint32_t memberIndex : solidMembers[i]) {
+                const auto& member = entries[memberIndex];
+                if (member.fileOffset > restored.size() ||
+                    member.uncompressedSize > restored.size() - member.fileOffset) {
+                    std::cerr << "Error: Solid member out of range: " << member.name << std::endl;
+                    allOk = false;
+                } else if (!plaintextMatches(member, restored.data() + member.fileOffset, member.uncompressedSize)) {
+                    std::cerr << "Error: Checksum mismatch for " << member.name << std::endl;
+                    allOk = false;
+                } else {
+                    std::cout << "OK: " << member.name << std::endl;
+                }
             }
         } catch (const std::exception& ex) {
-            std::cerr << "Error: Failed to decompress " << entry.filename << ": " << ex.what() << std::endl;
+            std::cerr << "Error: Failed to decompress " << entry.name << ": " << ex.what() << std::endl;
             allOk = false;
         }
     }
@@ -331,6 +1218,76 @@ bool ModularCompressor::testArchive(const std::string& inputFile) {
     return allOk;
 }
 
+std::vector<uint8_t> ModularCompressor::readRange(const std::string& inputFile,
+                                                  const std::string& entryName,
+                                                  uint64_t offset,
+                                                  uint64_t length) {
+    ArchiveReader archive(inputFile);
+    // 只访问目录与范围涉及的少数块
+    archive.advise(ArchiveReader::Access::Random);
+    auto& reader = archive.directory();
+    uint32_t index = 0;
+    if (!reader.find(entryName, index) || reader.entry(index).entryType == MRN_ENTRY_SOLID_BLOCK) {
+        throw std::runtime_error("Not found in archive: " + entryName);
+    }
+    const ArchiveEntry entry = reader.entry(index);
+    if (offset >= entry.uncompressedSize) {
+        return {};
+    }
+    length = std::min(length, entry.uncompressedSize - offset);
+    const uint64_t end = offset + length;
+
+    PipelineExecutor executor(pluginManager_);
+    if (entry.flags & MRN_FILE_FLAG_BLOCKED) {
+        // 块表记录了各块的原始大小，只读取并解码与范围相交的块
+        std::vector<uint8_t> range;
+        range.reserve(length);
+        uint64_t blockStart = 0;
+        for (const auto& record : readBlockTable(archive, entry)) {
+            const uint64_t blockEnd = blockStart + record.uncompressedSize;
+            if (blockEnd > offset) {
+                const auto block = decodeBlock(entry, record, archive.view(record.offset, record.compressedSize),
+                                               executor);
+                const auto first = block.begin() + static_cast<std::ptrdiff_t>(std::max(offset, blockStart) - blockStart);
+                const auto last = block.begin() + static_cast<std::ptrdiff_t>(std::min(end, blockEnd) - blockStart);
+                range.insert(range.end(), first, last);
+            }
+            if (blockEnd >= end) {
+                break;
+            }
+            blockStart = blockEnd;
+        }
+        return range;
+    }
+
+    // 固实成员位于所在块的 fileOffset 处，按块条目解码
+    ArchiveEntry source = entry;
+    uint64_t sourceOffset = offset;
+    if (entry.entryType == MRN_ENTRY_SOLID_MEMBER) {
+        source = reader.entry(entry.solidBlock);
+        if (source.entryType != MRN_ENTRY_SOLID_BLOCK) {
+            throw std::runtime_error("Solid member " + entry.name + " references an invalid block");
+        }
+        sourceOffset += entry.fileOffset;
+    }
+    // 原样存储的数据直接读取范围内的字节；只读部分数据时无法核对整条目的校验和
+    const uint8_t encoding = MRN_FILE_FLAG_COMPRESSED | MRN_FILE_FLAG_CHUNKED | MRN_FILE_FLAG_BLOCKED;
+    if (!(source.flags & encoding)) {
+        if (sourceOffset + length > source.compressedSize) {
+            throw std::runtime_error("Entry data out of range: " + entry.name);
+        }
+        return archive.view(source.fileOffset + sourceOffset, length).toVector();
+    }
+
+    const auto dictionary = archive.dictionary().toVector();
+    const auto restored = decodeEntry(source, archive.payload(source), executor, &archive, &dictionary);
+    if (sourceOffset + length > restored.size()) {
+        throw std::runtime_error("Entry data out of range: " + entry.name);
+    }
+    const auto first = restored.begin() + static_cast<std::ptrdiff_t>(sourceOffset);
+    return std::vector<uint8_t>(first, first + static_cast<std::ptrdiff_t>(length));
+}
+
 void ModularCompressor::setDefaultPipeline(const std::string& preset) {
     ConfigurationManager configMgr;
     CompressionPreset p;
@@ -361,15 +1318,38 @@ CompressionPipeline ModularCompressor::createCustomPipeline(const std::vector<st
 FileCompressionResult ModularCompressor::compressSingleFile(const std::string& filepath,
                                                             const std::string& archivePath,
                                                             const CompressionPipeline& pipeline,
-                                                            const CompressionOptions& options) {
-    auto data = FileIO::readFile(filepath);
+                                                            const CompressionOptions& options,
+                                                            const std::vector<uint8_t>* dictionary) {
     FileCompressionResult result;
+    // 输入以映射视图交给压缩算法，不复制到自有缓冲区
+    const auto input = FileIO::mapFile(filepath);
+    const auto data = input.view();
+    result.checksum = crc32c(data.data(), data.size());
     result.originalPath = filepath;
     result.archivePath = archivePath;
+    if (options.raceObjective != RaceObjective::Off) {
+        auto racedPipeline = pipeline;
+        auto racedOptions = options;
+        compressRaced(data, dictionary, racedPipeline, racedOptions, result);
+    } else {
+        compressBuffer(data, pipeline, options, dictionary, result);
+    }
+    input.verify();
     
+    // 获取文件元数据
+    readFileMetadata(input, result);
+    
+    return result;
+}
+
+void ModularCompressor::compressBuffer(ByteView data,
+                                       const CompressionPipeline& pipeline,
+                                       const CompressionOptions& options,
+                                       const std::vector<uint8_t>* dictionary,
+                                       FileCompressionResult& result) {
     // 如果设置了跳过压缩（如视频、已压缩文件），直接存储
     if (options.skipCompression) {
-        result.result.compressedData = data;
+        result.result.compressedData.assign(data.begin(), data.end());
         result.result.uncompressedSize = data.size();
         result.result.isCompressed = false;
     } else {
@@ -377,27 +1357,623 @@ FileCompressionResult ModularCompressor::compressSingleFile(const std::string& f
         if (!algorithm) {
             throw std::runtime_error("Algorithm not found: " + pipeline.mainAlgorithm);
         }
-        result.result = algorithm->compress(buildParams(pipeline, options), data);
+        PipelineExecutor executor(pluginManager_);
+        const auto chain = executor.resolve(pipeline.preprocessors);
+        auto params = buildParams(pipeline, options);
+        params.dictionary = dictionaryFor(dictionary, data.size());
+        params.incompressibleRatio = kIncompressibleRatio;
+        const auto transformed = executor.forward(chain, data);
+        result.result.compressedData.clear();
+        algorithm->compressInto(params, transformed, result.result);
+        result.result.uncompressedSize = data.size();
+        result.compressionLevel = static_cast<uint8_t>(std::min(std::max(options.compressionLevel, 0), 255));
+        if (!chain.empty()) {
+            for (auto* preprocessor : chain) {
+                result.preprocessorIds.push_back(preprocessor->getPreprocessorId());
+            }
+            result.transformedSize = transformed.size();
+        }
         
-        // 如果压缩后反而更大，使用原始数据
-        if (result.result.compressedData.size() >= data.size()) {
-            result.result.compressedData = data;
+        // 算法提前放弃或压缩后反而更大时，使用原始数据（不经过预处理）
+        if (!result.result.isCompressed || result.result.compressedData.size() >= data.size()) {
+            result.result.compressedData.assign(data.begin(), data.end());
             result.result.isCompressed = false;
+            result.result.stages = 0;
+            result.preprocessorIds.clear();
+            result.transformedSize = 0;
+        } else {
+            recordAlgorithm(pipeline, *algorithm, result);
         }
     }
-    
-    // 计算校验和（对压缩后的数据）
-    result.checksum = calculateChecksum(result.result.compressedData);
-    
-    // 获取文件元数据
-    if (std::filesystem::exists(filepath)) {
-        auto fileStatus = std::filesystem::status(filepath);
-        result.filePermissions = static_cast<uint16_t>(std::filesystem::perms::mask & fileStatus.permissions());
-        auto fileTime = std::filesystem::last_write_time(filepath);
-        result.modifiedTime = fileTime.time_since_epoch().count();
+}
+
+void ModularCompressor::raceAlgorithms(ByteView data,
+                                       const std::vector<uint8_t>* dictionary,
+                                       CompressionPipeline& pipeline,
+                                       CompressionOptions& options) {
+    if (options.skipCompression || data.size() < kRaceMinInput) {
+        return;
     }
-    
+    std::vector<uint8_t> sliced;
+    if (data.size() > kRaceSliceSize * kRaceSlices) {
+        sliced = raceSample(data);
+    }
+    const ByteView sample = sliced.empty() ? data : ByteView(sliced);
+    PipelineExecutor executor(pluginManager_);
+    const auto chain = executor.resolve(pipeline.preprocessors);
+    const auto transformed = executor.forward(chain, sample);
+    // 各次试压缩复用同一输出缓冲区
+    CompressionResult trial;
+
+    struct Candidate {
+        std::string algorithm;
+        int level = 0;
+        size_t size = 0;
+        double speed = 0.0; // 样本原始字节数 / 秒
+    };
+    // 各已注册算法的级别 1–9，另加配置的算法与级别（不在网格中时），保证默认设置始终参与比较
+    std::vector<std::pair<std::string, int>> trials;
+    for (const auto& name : pluginManager_.getAvailableAlgorithms()) {
+        for (int level = kRaceMinLevel; level <= kRaceMaxLevel; ++level) {
+            trials.emplace_back(name, level);
+        }
+    }
+    const std::pair<std::string, int> configured(pipeline.mainAlgorithm, options.compressionLevel);
+    if (pluginManager_.getAlgorithm(configured.first) &&
+        std::find(trials.begin(), trials.end(), configured) == trials.end()) {
+        trials.push_back(configured);
+    }
+
+    std::vector<Candidate> candidates;
+    for (const auto& [name, level] : trials) {
+        auto* algorithm = pluginManager_.getAlgorithm(name);
+        auto trialPipeline = pipeline;
+        trialPipeline.mainAlgorithm = name;
+        auto trialOptions = options;
+        trialOptions.compressionLevel = level;
+        auto params = buildParams(trialPipeline, trialOptions);
+        params.dictionary = dictionaryFor(dictionary, data.size());
+        const auto start = std::chrono::steady_clock::now();
+        trial.compressedData.clear();
+        algorithm->compressInto(params, transformed, trial);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const size_t size = trial.isCompressed ? trial.compressedData.size() : sample.size();
+        candidates.push_back({name, level, size, sample.size() / std::max(elapsed.count(), 1e-9)});
+    }
+    if (candidates.empty()) {
+        return;
+    }
+
+    // 样本输出最小者；大小相同时取更快的
+    const Candidate* best = &candidates.front();
+    for (const auto& candidate : candidates) {
+        if (candidate.size < best->size || (candidate.size == best->size && candidate.speed > best->speed)) {
+            best = &candidate;
+        }
+    }
+    // 速度目标：输出不超过上限的候选中最快者，没有候选满足上限时退回输出最小者
+    if (options.raceObjective == RaceObjective::Speed) {
+        const double bound = options.raceSizeBound * static_cast<double>(sample.size());
+        const Candidate* fastest = nullptr;
+        for (const auto& candidate : candidates) {
+            if (candidate.size <= bound && (!fastest || candidate.speed > fastest->speed)) {
+                fastest = &candidate;
+            }
+        }
+        if (fastest) {
+            best = fastest;
+        }
+    }
+
+    if (options.verbose) {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1);
+        oss << "竞速选中 " << best->algorithm << " 级别 " << best->level << " | 样本: " << sample.size()
+            << " bytes -> " << best->size << " bytes, " << best->speed / (1024.0 * 1024.0) << " MB/s";
+        Logger::instance().log(Logger::Level::Info, oss.str());
+    }
+    pipeline.mainAlgorithm = best->algorithm;
+    options.compressionLevel = best->level;
+}
+
+void ModularCompressor::compressRaced(ByteView data,
+                                      const std::vector<uint8_t>* dictionary,
+                                      CompressionPipeline& pipeline,
+                                      CompressionOptions& options,
+                                      FileCompressionResult& result) {
+    // 压缩前的 result 只有调用方填写的元数据，留一份给默认设置的核对使用
+    FileCompressionResult configured = result;
+    auto racedPipeline = pipeline;
+    auto racedOptions = options;
+    raceAlgorithms(data, dictionary, racedPipeline, racedOptions);
+    compressBuffer(data, racedPipeline, racedOptions, dictionary, result);
+
+    const bool changed = racedPipeline.mainAlgorithm != pipeline.mainAlgorithm ||
+                         racedOptions.compressionLevel != options.compressionLevel;
+    if (options.raceObjective == RaceObjective::Ratio && changed && !options.skipCompression) {
+        // 样本看不出随级别增大的块与窗口（以及高级别的变换选择），选中者在完整数据上可能不如默认设置；
+        // 以完整数据核对，保留较小的结果
+        compressBuffer(data, pipeline, options, dictionary, configured);
+        if (configured.result.compressedData.size() < result.result.compressedData.size()) {
+            if (options.verbose) {
+                Logger::instance().log(Logger::Level::Info,
+                                       "竞速选中者在完整数据上不如默认设置，改用 " + pipeline.mainAlgorithm + " 级别 " +
+                                           std::to_string(options.compressionLevel));
+            }
+            result = std::move(configured);
+            return;
+        }
+    }
+    pipeline = racedPipeline;
+    options = racedOptions;
+}
+
+FileCompressionResult ModularCompressor::compressBlockedFile(const std::string& filepath,
+                                                             const std::string& archivePath,
+                                                             const CompressionPipeline& pipeline,
+                                                             const CompressionOptions& options,
+                                                             ArchiveWriter& writer) {
+    // 各块是映射中的视图，由压缩任务直接读取；映射由在途任务共同持有
+    const auto input = std::make_shared<const MappedFile>(FileIO::mapFile(filepath));
+    const auto data = input->view();
+
+    FileCompressionResult result;
+    result.originalPath = filepath;
+    result.archivePath = archivePath;
+    result.blocked = true;
+    result.compressionLevel = static_cast<uint8_t>(std::min(std::max(options.compressionLevel, 0), 255));
+
+    std::vector<uint8_t> table;
+    uint64_t blockCount = 0;
+    uint32_t combinedCrc = 0;
+    bool firstBlock = true;
+
+    // 开头几块都只能存储时，尚未开始的块改为直接存储
+    auto storeRemaining = std::make_shared<std::atomic<bool>>(false);
+    uint64_t storedBlocks = 0;
+
+    // 按提交顺序写出已完成的块；等待队首时后续块仍在其他线程上压缩
+    std::deque<std::future<FileCompressionResult>> inFlight;
+    auto writeFront = [&]() {
+        auto block = inFlight.front().get();
+        inFlight.pop_front();
+        const uint64_t offset = writer.writeBlob(block.result.compressedData);
+        if (firstBlock) {
+            result.payloadOffset = offset;
+            firstBlock = false;
+        }
+
+        BlockRecord record;
+        record.compressedSize = block.result.compressedData.size();
+        record.uncompressedSize = block.result.uncompressedSize;
+        record.flags = MRN_FILE_FLAG_CRC32C;
+        if (block.result.isCompressed) {
+            record.flags |= MRN_FILE_FLAG_COMPRESSED |
+                            (block.result.stages & (MRN_FILE_FLAG_STAGE_MASK | MRN_FILE_FLAG_DICTIONARY));
+            record.preprocessorIds = block.preprocessorIds;
+            record.transformedSize = block.transformedSize;
+            // 各块使用同一算法与参数，记录在条目上
+            result.algorithmId = block.algorithmId;
+            result.algorithmParams = block.algorithmParams;
+        }
+        record.crc = block.checksum;
+        appendBlockRecord(table, record);
+
+        combinedCrc = crc32cCombine(combinedCrc, block.checksum, block.result.uncompressedSize);
+        result.result.uncompressedSize += block.result.uncompressedSize;
+        result.blockBytes += record.compressedSize;
+        ++blockCount;
+        storedBlocks += block.result.isCompressed ? 0 : 1;
+        if (blockCount == kAbortAfterStoredBlocks && storedBlocks == blockCount) {
+            storeRemaining->store(true);
+        }
+    };
+
+    // 竞速模式以第一块为样本选定算法与级别，所有块沿用
+    auto racedPipeline = pipeline;
+    auto racedOptions = options;
+    bool raced = options.raceObjective == RaceObjective::Off;
+
+    // 在途块数限制为线程数的两倍，内存占用与文件大小无关
+    const size_t maxInFlight = std::max<size_t>(2, threadPool_->size() * 2);
+    for (size_t offset = 0; offset < data.size(); offset += options.splitBlockSize) {
+        const auto block = data.subview(offset, std::min<uint64_t>(options.splitBlockSize, data.size() - offset));
+        if (!raced) {
+            // 第一块在当前线程上竞速并核对，其结果直接作为第一块写出
+            FileCompressionResult first;
+            first.checksum = crc32c(block.data(), block.size());
+            compressRaced(block, nullptr, racedPipeline, racedOptions, first);
+            result.compressionLevel = static_cast<uint8_t>(racedOptions.compressionLevel);
+            raced = true;
+            std::promise<FileCompressionResult> ready;
+            ready.set_value(std::move(first));
+            inFlight.push_back(ready.get_future());
+            continue;
+        }
+        if (inFlight.size() >= maxInFlight) {
+            writeFront();
+        }
+        inFlight.push_back(threadPool_->enqueue([this, input, block, pipeline = racedPipeline,
+                                                 options = racedOptions, storeRemaining] {
+            FileCompressionResult compressed;
+            auto blockOptions = options;
+            blockOptions.skipCompression = blockOptions.skipCompression || storeRemaining->load();
+            compressed.checksum = crc32c(block.data(), block.size());
+            compressBuffer(block, pipeline, blockOptions, nullptr, compressed);
+            return compressed;
+        }));
+    }
+    while (!inFlight.empty()) {
+        writeFront();
+    }
+    input->verify();
+
+    // 块表：[varint 块数] + 各块记录，末尾 4 字节为块表长度
+    std::vector<uint8_t> payload;
+    writeVarint(payload, blockCount);
+    payload.insert(payload.end(), table.begin(), table.end());
+    const auto tableSize = static_cast<uint32_t>(payload.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        payload.push_back(static_cast<uint8_t>(tableSize >> shift));
+    }
+    if (firstBlock) {
+        // 文件在切块判断之后变为空：块表紧接在当前位置
+        result.payloadOffset = writer.writeBlob({});
+    }
+    result.result.compressedData = std::move(payload);
+    result.result.isCompressed = false;
+    result.checksum = combinedCrc;
+    readFileMetadata(*input, result);
     return result;
 }
 
+void ModularCompressor::decodeBlockedEntry(const ArchiveEntry& entry,
+                                           PipelineExecutor& executor,
+                                           const ArchiveReader& archive,
+                                           const std::function<void(const std::vector<uint8_t>&)>& sink) {
+    for (const auto& record : readBlockTable(archive, entry)) {
+        sink(decodeBlock(entry, record, archive.view(record.offset, record.compressedSize), executor));
+    }
+}
+
+std::vector<uint8_t> ModularCompressor::decodeBlock(const ArchiveEntry& entry,
+                                                    const BlockRecord& record,
+                                                    ByteView payload,
+                                                    PipelineExecutor& executor) {
+    // 每块按普通条目解码；块数据不引用归档中的其他位置，不需要 archive
+    ArchiveEntry blockEntry;
+    blockEntry.name = "block at offset " + std::to_string(record.offset);
+    blockEntry.flags = record.flags;
+    blockEntry.uncompressedSize = record.uncompressedSize;
+    blockEntry.preprocessorCount = static_cast<uint8_t>(record.preprocessorIds.size());
+    std::copy(record.preprocessorIds.begin(), record.preprocessorIds.end(), blockEntry.preprocessorIds);
+    blockEntry.transformedSize = record.transformedSize;
+    blockEntry.checksum = record.crc;
+    blockEntry.algorithmId = entry.algorithmId;
+    blockEntry.algorithmParams = entry.algorithmParams;
+    auto block = decodeEntry(blockEntry, payload, executor, nullptr, nullptr);
+    const bool legacyCrc = !(record.flags & MRN_FILE_FLAG_CRC32C);
+    if (block.size() != record.uncompressedSize || (legacyCrc && crc32Of(block) != record.crc)) {
+        throw std::runtime_error("Checksum mismatch in block at offset " + std::to_string(record.offset));
+    }
+    return block;
+}
+
+ModularCompressor::SolidBlockResult ModularCompressor::compressSolidBlock(
+    const std::vector<DirectoryScanner::FileInfo>& files,
+    const CompressionPipeline& pipeline,
+    const CompressionOptions& options) {
+    SolidBlockResult solid;
+    std::vector<uint8_t> data;
+    uint32_t blockCrc = 0;
+    for (const auto& file : files) {
+        FileCompressionResult member;
+        // 成员没有独立负载，校验和取自其原始数据；内容从映射直接拼入块
+        const auto input = FileIO::mapFile(file.path);
+        const auto content = input.view();
+        member.checksum = crc32c(content.data(), content.size());
+        member.originalPath = file.path;
+        member.archivePath = file.relativePath;
+        member.entryType = MRN_ENTRY_SOLID_MEMBER;
+        member.solidOffset = data.size();
+        member.result.uncompressedSize = content.size();
+        member.result.isCompressed = false;
+        blockCrc = crc32cCombine(blockCrc, member.checksum, content.size());
+        readFileMetadata(input, member);
+        solid.members.push_back(std::move(member));
+        data.insert(data.end(), content.begin(), content.end());
+        input.verify();
+    }
+
+    solid.block.entryType = MRN_ENTRY_SOLID_BLOCK;
+    solid.block.checksum = blockCrc;
+    compressBuffer(data, pipeline, options, nullptr, solid.block);
+    for (auto& member : solid.members) {
+        member.compressionLevel = solid.block.compressionLevel;
+    }
+    return solid;
+}
+
+std::vector<uint8_t> ModularCompressor::prepareDictionary(const std::vector<DirectoryScanner::FileInfo>& files,
+                                                          const CompressionPipeline& pipeline,
+                                                          const CompressionOptions& options) {
+    ConfigurationManager configMgr;
+    std::vector<uint8_t> dictionary;
+    if (!options.dictionaryName.empty()) {
+        dictionary = configMgr.loadDictionary(options.dictionaryName);
+    } else if (options.trainDictionary && !options.skipCompression) {
+        std::vector<const DirectoryScanner::FileInfo*> smallFiles;
+        uint64_t smallBytes = 0;
+        for (const auto& file : files) {
+            if (file.size > 0 && file.size <= kDictionaryFileLimit) {
+                smallFiles.push_back(&file);
+                smallBytes += file.size;
+            }
+        }
+        if (smallFiles.size() < kMinDictionarySamples) {
+            return dictionary;
+        }
+
+        // 样本总量超出上限时等间隔抽取
+        const size_t step = static_cast<size_t>((smallBytes + kMaxDictionarySampleBytes - 1) / kMaxDictionarySampleBytes);
+        std::vector<uint8_t> samples;
+        std::vector<size_t> sampleSizes;
+        // 样本只影响字典质量，不核对是否被截断：截断的文件在随后压缩时报错
+        for (size_t i = 0; i < smallFiles.size(); i += std::max<size_t>(step, 1)) {
+            const auto data = FileIO::mapFile(smallFiles[i]->path);
+            samples.insert(samples.end(), data.data(), data.data() + data.size());
+            sampleSizes.push_back(data.size());
+        }
+        // 字典不超过样本的 1/8，避免小目录为字典付出比收益更多的空间
+        const size_t dictionarySize = std::min(DictionaryTrainer::kDefaultDictionarySize, samples.size() / 8);
+        dictionary = DictionaryTrainer::train(samples, sampleSizes, dictionarySize);
+
+        // 抽取部分样本试压缩，估算的总收益不足以抵消字典本身的存储开销时放弃
+        auto algorithm = pluginManager_.getAlgorithm(pipeline.mainAlgorithm);
+        if (!dictionary.empty() && algorithm) {
+            auto params = buildParams(pipeline, options);
+            const size_t trialStep = std::max<size_t>(1, samples.size() / kDictionaryTrialBytes + 1);
+            uint64_t trialBytes = 0;
+            int64_t saved = 0;
+            size_t offset = 0;
+            for (size_t i = 0; i < sampleSizes.size(); offset += sampleSizes[i], ++i) {
+                if (i % trialStep != 0) {
+                    continue;
+                }
+                const auto sample = ByteView(samples).subview(offset, sampleSizes[i]);
+                params.dictionary = nullptr;
+                const auto plain = algorithm->compress(params, sample).compressedData.size();
+                params.dictionary = &dictionary;
+                const auto primed = algorithm->compress(params, sample).compressedData.size();
+                saved += static_cast<int64_t>(std::min(plain, sample.size())) -
+                         static_cast<int64_t>(std::min(primed, sample.size()));
+                trialBytes += sample.size();
+            }
+            const double estimated = trialBytes > 0 ? static_cast<double>(saved) * smallBytes / trialBytes : 0.0;
+            if (estimated <= static_cast<double>(dictionary.size())) {
+                dictionary.clear();
+            }
+        }
+        Logger::instance().log(Logger::Level::Info,
+                               "共享字典: " + std::to_string(sampleSizes.size()) + " 个样本, " +
+                                   std::to_string(dictionary.size()) + " bytes");
+    }
+
+    if (!options.saveDictionaryName.empty()) {
+        if (dictionary.empty()) {
+            Logger::instance().log(Logger::Level::Warn, "小文件样本不足，未生成共享字典");
+        } else {
+            configMgr.saveDictionary(options.saveDictionaryName, dictionary);
+        }
+    }
+    return dictionary;
+}
+
+FileCompressionResult ModularCompressor::compressChunkedFile(const std::string& filepath,
+                                                             const std::string& archivePath,
+                                                             const CompressionPipeline& pipeline,
+                                                             const CompressionOptions& options,
+                                                             ChunkStore& store,
+                                                             const std::vector<uint8_t>* dictionary) {
+    FileCompressionResult result;
+    const auto input = FileIO::mapFile(filepath);
+    const auto data = input.view();
+    result.checksum = crc32c(data.data(), data.size());
+    result.originalPath = filepath;
+    result.archivePath = archivePath;
+    result.chunked = true;
+    result.result.uncompressedSize = data.size();
+    result.compressionLevel = static_cast<uint8_t>(std::min(std::max(options.compressionLevel, 0), 255));
+
+    ICompressionAlgorithm* algorithm = nullptr;
+    if (!options.skipCompression) {
+        algorithm = pluginManager_.getAlgorithm(pipeline.mainAlgorithm);
+        if (!algorithm) {
+            throw std::runtime_error("Algorithm not found: " + pipeline.mainAlgorithm);
+        }
+        recordAlgorithm(pipeline, *algorithm, result);
+    }
+    auto params = buildParams(pipeline, options);
+    // 整个文件只有一块的小文件同样用共享字典预热
+    params.dictionary = dictionaryFor(dictionary, data.size());
+
+    // 块之间相互独立，不经过预处理器链，保证同内容的块在任何文件里编码相同
+    size_t begin = 0;
+    for (size_t end : ContentChunker::split(data.data(), data.size())) {
+        bool owner = false;
+        const uint32_t id = store.acquire(digestChunk(data.data() + begin, end - begin), owner);
+        if (owner) {
+            try {
+                StoredChunk chunk;
+                chunk.uncompressedSize = end - begin;
+                const auto piece = data.subview(begin, end - begin);
+                if (algorithm) {
+                    auto compressed = algorithm->compress(params, piece);
+                    if (compressed.compressedData.size() < piece.size()) {
+                        chunk.payload = std::move(compressed.compressedData);
+                        chunk.isCompressed = true;
+                    }
+                }
+                if (!chunk.isCompressed) {
+                    chunk.payload = piece.toVector();
+                }
+                store.publish(id, std::move(chunk));
+            } catch (...) {
+                store.fail(id, std::current_exception());
+                throw;
+            }
+        }
+        result.chunkIds.push_back(id);
+        begin = end;
+    }
+    input.verify();
+
+    readFileMetadata(input, result);
+    return result;
+}
+
+void ModularCompressor::resolveChunkRefs(ArchiveWriter& writer,
+                                         ChunkStore& store,
+                                         FileCompressionResult& result) {
+    // 负载格式：[varint 块数] 之后每块 [varint 偏移][varint 压缩大小][varint 原始大小][u8 标志]
+    std::vector<uint8_t> refs;
+    writeVarint(refs, result.chunkIds.size());
+    for (uint32_t id : result.chunkIds) {
+        auto& slot = store.slot(id);
+        if (!slot.written) {
+            const StoredChunk& chunk = slot.chunk.get();
+            slot.offset = writer.writeBlob(chunk.payload);
+            slot.compressedSize = chunk.payload.size();
+            slot.uncompressedSize = chunk.uncompressedSize;
+            slot.isCompressed = chunk.isCompressed;
+            slot.written = true;
+            // 块已落盘，释放负载
+            slot.chunk = std::shared_future<StoredChunk>();
+        }
+        writeVarint(refs, slot.offset);
+        writeVarint(refs, slot.compressedSize);
+        writeVarint(refs, slot.uncompressedSize);
+        refs.push_back(slot.isCompressed ? kChunkRefCompressed : 0);
+    }
+    result.result.compressedData = std::move(refs);
+}
+
+ICompressionAlgorithm& ModularCompressor::algorithmFor(const ArchiveEntry& entry) {
+    // 旧版归档不记录算法，条目均以默认算法压缩
+    auto* algorithm = entry.algorithmId != 0 ? pluginManager_.getAlgorithmById(entry.algorithmId)
+                                             : pluginManager_.getAlgorithm(defaultPipeline_.mainAlgorithm);
+    if (!algorithm) {
+        std::ostringstream oss;
+        oss << "Algorithm 0x" << std::hex << entry.algorithmId << " not registered for " << entry.name;
+        throw std::runtime_error(oss.str());
+    }
+    return *algorithm;
+}
+
+std::vector<uint8_t> ModularCompressor::decodeEntry(const ArchiveEntry& entry,
+                                                    ByteView payload,
+                                                    PipelineExecutor& executor,
+                                                    const ArchiveReader* archive,
+                                                    const std::vector<uint8_t>* dictionary) {
+    auto restored = decodePayload(entry, payload, executor, archive, dictionary);
+    // 切块条目已逐块校验，块 CRC 的合并结果在读取块表时与条目核对过；
+    // 固实块由调用方按成员切片校验，成员覆盖整个块，不必再整体计算一遍
+    const bool verifiedElsewhere = (entry.flags & MRN_FILE_FLAG_BLOCKED) || entry.entryType == MRN_ENTRY_SOLID_BLOCK;
+    if (!verifiedElsewhere && !plaintextMatches(entry, restored.data(), restored.size())) {
+        throw std::runtime_error("Checksum mismatch: " + entry.name);
+    }
+    return restored;
+}
+
+ByteView ModularCompressor::restoreEntry(const ArchiveEntry& entry,
+                                         ByteView payload,
+                                         PipelineExecutor& executor,
+                                         const ArchiveReader* archive,
+                                         const std::vector<uint8_t>* dictionary,
+                                         std::vector<uint8_t>& storage) {
+    const uint8_t encoding = MRN_FILE_FLAG_COMPRESSED | MRN_FILE_FLAG_CHUNKED | MRN_FILE_FLAG_BLOCKED;
+    if (entry.flags & encoding) {
+        storage = decodeEntry(entry, payload, executor, archive, dictionary);
+        return storage;
+    }
+    // 固实块由调用方按成员校验，与 decodeEntry 一致
+    if (entry.entryType != MRN_ENTRY_SOLID_BLOCK && !plaintextMatches(entry, payload.data(), payload.size())) {
+        throw std::runtime_error("Checksum mismatch: " + entry.name);
+    }
+    return payload;
+}
+
+std::vector<uint8_t> ModularCompressor::decodePayload(const ArchiveEntry& entry,
+                                                      ByteView payload,
+                                                      PipelineExecutor& executor,
+                                                      const ArchiveReader* archive,
+                                                      const std::vector<uint8_t>* dictionary) {
+    if ((entry.flags & (MRN_FILE_FLAG_BLOCKED | MRN_FILE_FLAG_CHUNKED)) && !archive) {
+        throw std::runtime_error("Entry references archive data: " + entry.name);
+    }
+    if (entry.flags & MRN_FILE_FLAG_BLOCKED) {
+        std::vector<uint8_t> restored;
+        decodeBlockedEntry(entry, executor, *archive, [&restored](const std::vector<uint8_t>& block) {
+            restored.insert(restored.end(), block.begin(), block.end());
+        });
+        return restored;
+    }
+    if (entry.flags & MRN_FILE_FLAG_CHUNKED) {
+        std::vector<uint8_t> restored;
+        restored.reserve(entry.uncompressedSize);
+        size_t pos = 0;
+        const uint64_t count = readVarint(payload.data(), payload.size(), pos);
+        for (uint64_t i = 0; i < count; ++i) {
+            const uint64_t offset = readVarint(payload.data(), payload.size(), pos);
+            const uint64_t compressedSize = readVarint(payload.data(), payload.size(), pos);
+            const uint64_t uncompressedSize = readVarint(payload.data(), payload.size(), pos);
+            if (pos >= payload.size()) {
+                throw std::runtime_error("Truncated chunk reference list");
+            }
+            const uint8_t chunkFlags = payload[pos++];
+            const auto chunk = archive->view(offset, compressedSize);
+
+            if (chunkFlags & kChunkRefCompressed) {
+                DecompressParams params;
+                params.config.values = entry.algorithmParams;
+                params.expectedSize = uncompressedSize;
+                params.dataIsCompressed = true;
+                params.dictionary = dictionary;
+                // 块直接解码到结果末尾
+                const size_t before = restored.size();
+                algorithmFor(entry).decompressInto(params, chunk, restored);
+                if (restored.size() - before != uncompressedSize) {
+                    throw std::runtime_error("Chunk size mismatch");
+                }
+            } else {
+                if (compressedSize != uncompressedSize) {
+                    throw std::runtime_error("Chunk size mismatch");
+                }
+                restored.insert(restored.end(), chunk.begin(), chunk.end());
+            }
+        }
+        return restored;
+    }
+
+    const bool compressed = (entry.flags & MRN_FILE_FLAG_COMPRESSED) != 0;
+    if (!compressed) {
+        return payload.toVector();
+    }
+
+    DecompressParams params;
+    params.config.values = entry.algorithmParams;
+    params.expectedSize = entry.preprocessorCount > 0 ? entry.transformedSize : entry.uncompressedSize;
+    params.dataIsCompressed = true;
+    params.dictionary = dictionary;
+    // 负载视图（通常指向归档映射）直接交给算法解码
+    std::vector<uint8_t> decoded;
+    algorithmFor(entry).decompressInto(params, payload, decoded);
+    if (entry.preprocessorCount == 0) {
+        return decoded;
+    }
+
+    const auto chain = executor.resolve(entry.preprocessorIds, entry.preprocessorCount);
+    return executor.inverse(chain, decoded).toVector();
+}
+
 } // namespace mrn
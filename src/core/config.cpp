@@ -1,9 +1,15 @@
 #include "core/config.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <sstream>
+#include <stdexcept>
+
+#include "utils/content_probe.h"
 
 namespace mrn {
 
@@ -16,18 +22,36 @@ CompressionPreset makePreset(const std::string& name, int level, bool skipCompre
     preset.options.skipCompression = skipCompression; // 标记是否跳过压缩
     return preset;
 }
+
+// 字典文件：4 字节魔数后接字典内容
+constexpr char kDictionaryMagic[4] = {'M', 'R', 'N', 'D'};
+
+// 可执行文件的相对跳转改写为绝对地址，非机器码输入原样通过（只多一字节）；未编译插件时跳过
+void addBranchFilter(CompressionPreset& preset) {
+    if (PluginManager::getInstance().getPreprocessor("bcj")) {
+        preset.pipeline.preprocessors = {"bcj"};
+    }
+}
 }
 
 CompressionPreset CompressionPreset::createTextPreset() {
-    return makePreset("text", 6);
+    auto preset = makePreset("text", 6);
+    // 文本与日志上块排序变换明显优于 LZ
+    preset.pipeline.algorithmConfigs["moverun"].values["transform"] = "bwt";
+    return preset;
 }
 
 CompressionPreset CompressionPreset::createBinaryPreset() {
-    return makePreset("binary", 5);
+    auto preset = makePreset("binary", 5);
+    addBranchFilter(preset);
+    return preset;
 }
 
 CompressionPreset CompressionPreset::createMaximumPreset() {
-    return makePreset("maximum", 9);
+    auto preset = makePreset("maximum", 9);
+    // 不加 BCJ 时可执行文件上反而不如二进制预设
+    addBranchFilter(preset);
+    return preset;
 }
 
 CompressionPreset CompressionPreset::createFastPreset() {
@@ -62,6 +86,8 @@ void ConfigurationManager::loadUserConfig(const std::string& configFile) {
             } else if (key.find("filetype.") == 0) {
                 std::string ext = key.substr(9);
                 fileAssociations_[ext] = value;
+            } else if (key == "dictionary.dir") {
+                dictionaryDirectory_ = value;
             }
         }
     }
@@ -79,6 +105,11 @@ void ConfigurationManager::saveUserConfig(const std::string& configFile) {
         file << "filetype." << ext << "=" << preset << "\n";
     }
     
+    if (!dictionaryDirectory_.empty()) {
+        file << "\n# Shared dictionaries\n";
+        file << "dictionary.dir=" << dictionaryDirectory_ << "\n";
+    }
+
     file << "\n# Custom presets\n";
     for (const auto& [name, preset] : presets_) {
         file << "preset." << name << ".algorithm=" << preset.pipeline.mainAlgorithm << "\n";
@@ -91,6 +122,19 @@ CompressionPreset ConfigurationManager::getPreset(const std::string& name) {
     if (it != presets_.end()) {
         return it->second;
     }
+    // 内置预设
+    if (name == "binary") {
+        return CompressionPreset::createBinaryPreset();
+    }
+    if (name == "maximum") {
+        return CompressionPreset::createMaximumPreset();
+    }
+    if (name == "fast") {
+        return CompressionPreset::createFastPreset();
+    }
+    if (name == "store") {
+        return CompressionPreset::createStorePreset();
+    }
     return CompressionPreset::createTextPreset();
 }
 
@@ -99,56 +143,100 @@ void ConfigurationManager::addCustomPreset(const std::string& name,
     presets_[name] = preset;
 }
 
-CompressionPreset ConfigurationManager::detectBestPreset(const std::string& filename) {
-    std::filesystem::path path(filename);
-    std::string ext = path.extension().string();
+std::string ConfigurationManager::dictionaryPath(const std::string& name) const {
+    if (name.find('/') != std::string::npos || name.find('\\') != std::string::npos) {
+        return name;
+    }
+    std::filesystem::path directory;
+    if (!dictionaryDirectory_.empty()) {
+        directory = dictionaryDirectory_;
+    } else if (const char* env = std::getenv("MRN_DICT_DIR")) {
+        directory = env;
+    } else if (const char* home = std::getenv("HOME")) {
+        directory = std::filesystem::path(home) / ".mrn" / "dictionaries";
+    } else {
+        directory = std::filesystem::path(".mrn") / "dictionaries";
+    }
+    return (directory / (name + ".dict")).string();
+}
+
+std::vector<uint8_t> ConfigurationManager::loadDictionary(const std::string& name) const {
+    const auto path = dictionaryPath(name);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Dictionary not found: " + path);
+    }
+    char magic[sizeof(kDictionaryMagic)] = {};
+    file.read(magic, sizeof(magic));
+    if (!file || std::memcmp(magic, kDictionaryMagic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Invalid dictionary file: " + path);
+    }
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void ConfigurationManager::saveDictionary(const std::string& name, const std::vector<uint8_t>& dictionary) const {
+    const std::filesystem::path path(dictionaryPath(name));
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to write dictionary: " + path.string());
+    }
+    file.write(kDictionaryMagic, sizeof(kDictionaryMagic));
+    file.write(reinterpret_cast<const char*>(dictionary.data()), static_cast<std::streamsize>(dictionary.size()));
+}
+
+namespace {
+std::string lowerExtension(const std::string& filename) {
+    std::string ext = std::filesystem::path(filename).extension().string();
     if (!ext.empty() && ext[0] == '.') {
         ext = ext.substr(1);
     }
-    
     // 转换为小写
     std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    
-    // 检查文件类型关联
-    auto it = fileAssociations_.find(ext);
-    if (it != fileAssociations_.end()) {
-        return getPreset(it->second);
-    }
-    
-    // 根据扩展名推断 - 智能文件类型检测
+    return ext;
+}
+
+// 根据扩展名推断预设，未知扩展名返回 false
+bool presetForExtension(const std::string& ext, CompressionPreset& preset) {
+    auto choose = [&](CompressionPreset chosen) {
+        preset = std::move(chosen);
+        return true;
+    };
     
     // 视频文件：通常已高度压缩，直接存储
     if (ext == "mp4" || ext == "avi" || ext == "mkv" || ext == "mov" || ext == "wmv" ||
         ext == "flv" || ext == "webm" || ext == "m4v" || ext == "mpg" || ext == "mpeg" ||
         ext == "3gp" || ext == "ogv" || ext == "ts" || ext == "mts") {
-        return CompressionPreset::createStorePreset();
+        return choose(CompressionPreset::createStorePreset());
     }
     
     // 音频文件：通常已压缩，直接存储
     if (ext == "mp3" || ext == "aac" || ext == "ogg" || ext == "wma" || ext == "flac" ||
         ext == "m4a" || ext == "wav" || ext == "opus" || ext == "ape") {
-        return CompressionPreset::createStorePreset();
+        return choose(CompressionPreset::createStorePreset());
     }
     
     // 已压缩的归档文件：直接存储
     if (ext == "zip" || ext == "gz" || ext == "bz2" || ext == "xz" || ext == "7z" ||
         ext == "rar" || ext == "tar" || ext == "cab" || ext == "iso" || ext == "dmg") {
-        return CompressionPreset::createStorePreset();
+        return choose(CompressionPreset::createStorePreset());
     }
     
     // 已压缩的图片格式：使用快速模式（可能仍有少量冗余）
     if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "gif" || ext == "webp") {
-        return CompressionPreset::createFastPreset();
+        return choose(CompressionPreset::createFastPreset());
     }
     
     // 未压缩的图片格式：使用二进制预设
     if (ext == "bmp" || ext == "tiff" || ext == "tif" || ext == "raw" || ext == "psd") {
-        return CompressionPreset::createBinaryPreset();
+        return choose(CompressionPreset::createBinaryPreset());
     }
     
     // 文档文件：文本类，使用文本预设
     if (ext == "txt" || ext == "md" || ext == "rst" || ext == "log" || ext == "csv") {
-        return CompressionPreset::createTextPreset();
+        return choose(CompressionPreset::createTextPreset());
     }
     
     // 代码文件：使用文本预设
@@ -156,40 +244,97 @@ CompressionPreset ConfigurationManager::detectBestPreset(const std::string& file
         ext == "cxx" || ext == "java" || ext == "py" || ext == "js" || ext == "ts" ||
         ext == "go" || ext == "rs" || ext == "swift" || ext == "kt" || ext == "scala" ||
         ext == "php" || ext == "rb" || ext == "pl" || ext == "sh" || ext == "bash") {
-        return CompressionPreset::createTextPreset();
+        return choose(CompressionPreset::createTextPreset());
     }
     
     // 标记语言和配置文件：使用文本预设
     if (ext == "xml" || ext == "html" || ext == "htm" || ext == "css" || ext == "scss" ||
         ext == "json" || ext == "yaml" || ext == "yml" || ext == "toml" || ext == "ini" ||
         ext == "conf" || ext == "config" || ext == "properties") {
-        return CompressionPreset::createTextPreset();
+        return choose(CompressionPreset::createTextPreset());
     }
     
     // 文档格式：根据类型选择
     if (ext == "pdf") {
         // PDF可能已压缩，使用快速模式
-        return CompressionPreset::createFastPreset();
+        return choose(CompressionPreset::createFastPreset());
     }
     if (ext == "doc" || ext == "docx" || ext == "xls" || ext == "xlsx" || 
         ext == "ppt" || ext == "pptx" || ext == "odt" || ext == "ods" || ext == "odp") {
         // Office文档通常有压缩，使用快速模式
-        return CompressionPreset::createFastPreset();
+        return choose(CompressionPreset::createFastPreset());
     }
     
     // 可执行文件和库文件：使用二进制预设
     if (ext == "exe" || ext == "dll" || ext == "so" || ext == "dylib" || ext == "bin" ||
         ext == "app" || ext == "deb" || ext == "rpm" || ext == "pkg") {
-        return CompressionPreset::createBinaryPreset();
+        return choose(CompressionPreset::createBinaryPreset());
     }
     
     // 数据库文件：使用二进制预设
     if (ext == "db" || ext == "sqlite" || ext == "sqlite3" || ext == "mdb") {
-        return CompressionPreset::createBinaryPreset();
+        return choose(CompressionPreset::createBinaryPreset());
+    }
+
+    return false;
+}
+} // namespace
+
+CompressionPreset ConfigurationManager::detectBestPreset(const std::string& filename) {
+    const auto ext = lowerExtension(filename);
+
+    // 用户配置的文件类型关联优先
+    auto it = fileAssociations_.find(ext);
+    if (it != fileAssociations_.end()) {
+        return getPreset(it->second);
+    }
+
+    // 先看内容：魔数比扩展名可靠，也能识别改名或没有扩展名的文件
+    const auto probe = ContentProber::probeFile(filename);
+    const bool probed = probe.sampleSize > 0;
+    switch (probe.kind) {
+        case ContentKind::Compressed:
+            // 短魔数（如 "BZh"、"ID3"、"MRN"）也可能是普通文本的开头，样本像文本时不信任魔数
+            if (probed && probe.text) {
+                break;
+            }
+            return CompressionPreset::createStorePreset();
+        case ContentKind::Document:
+            return CompressionPreset::createFastPreset();
+        case ContentKind::Executable:
+        case ContentKind::Database:
+            return CompressionPreset::createBinaryPreset();
+        case ContentKind::Unknown:
+            break;
+    }
+    // 样本熵接近 8 比特/字节：已压缩或加密的数据，整体压缩只会白白耗费 CPU
+    if (probe.sampleSize >= ContentProber::kSampleSize && probe.entropy > ContentProber::kIncompressibleEntropy) {
+        return CompressionPreset::createStorePreset();
+    }
+
+    // 读到了内容时，扩展名给出的“直接存储”已被上面的探测否定
+    CompressionPreset preset;
+    if (presetForExtension(ext, preset) && !(probed && preset.options.skipCompression)) {
+        return preset;
+    }
+    if (probed && probe.text) {
+        return CompressionPreset::createTextPreset();
     }
-    
     // 默认使用二进制预设
     return CompressionPreset::createBinaryPreset();
 }
 
+CompressionPreset ConfigurationManager::detectPresetByName(const std::string& filename) {
+    const auto ext = lowerExtension(filename);
+    auto it = fileAssociations_.find(ext);
+    if (it != fileAssociations_.end()) {
+        return getPreset(it->second);
+    }
+    CompressionPreset preset;
+    if (presetForExtension(ext, preset)) {
+        return preset;
+    }
+    return CompressionPreset::createBinaryPreset();
+}
+
 } // namespace mrn
@@ -0,0 +1,68 @@
+#include "core/pipeline_executor.h"
+
+#include <stdexcept>
+
+#include "core/archive_format.h"
+
+namespace mrn {
+
+PipelineExecutor::PipelineExecutor(PluginManager& pluginManager)
+    : pluginManager_(pluginManager) {}
+
+std::vector<IPreprocessor*> PipelineExecutor::resolve(const std::vector<std::string>& names) const {
+    if (names.size() > MRN_MAX_PREPROCESSORS) {
+        throw std::runtime_error("Too many preprocessors in pipeline");
+    }
+    std::vector<IPreprocessor*> chain;
+    for (const auto& name : names) {
+        auto* preprocessor = pluginManager_.getPreprocessor(name);
+        if (!preprocessor) {
+            throw std::runtime_error("Preprocessor not found: " + name);
+        }
+        if (preprocessor->getPreprocessorId() == 0) {
+            throw std::runtime_error("Preprocessor has no ID: " + name);
+        }
+        chain.push_back(preprocessor);
+    }
+    return chain;
+}
+
+std::vector<IPreprocessor*> PipelineExecutor::resolve(const uint32_t* ids, size_t count) const {
+    if (count > MRN_MAX_PREPROCESSORS) {
+        throw std::runtime_error("Too many preprocessors in entry");
+    }
+    std::vector<IPreprocessor*> chain;
+    for (size_t i = 0; i < count; ++i) {
+        auto* preprocessor = pluginManager_.getPreprocessorById(ids[i]);
+        if (!preprocessor) {
+            throw std::runtime_error("Preprocessor not found for ID " + std::to_string(ids[i]));
+        }
+        chain.push_back(preprocessor);
+    }
+    return chain;
+}
+
+ByteView PipelineExecutor::forward(const std::vector<IPreprocessor*>& chain, ByteView input) {
+    ByteView current = input;
+    // 输入本身可能是上一次调用返回的内部缓冲区，从另一个缓冲区开始写
+    size_t target = !input.empty() && input.data() == buffers_[0].data() ? 1 : 0;
+    for (auto* preprocessor : chain) {
+        preprocessor->processInto(current, buffers_[target]);
+        current = buffers_[target];
+        target ^= 1;
+    }
+    return current;
+}
+
+ByteView PipelineExecutor::inverse(const std::vector<IPreprocessor*>& chain, ByteView input) {
+    ByteView current = input;
+    size_t target = !input.empty() && input.data() == buffers_[0].data() ? 1 : 0;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        (*it)->inverseProcessInto(current, buffers_[target]);
+        current = buffers_[target];
+        target ^= 1;
+    }
+    return current;
+}
+
+} // namespace mrn
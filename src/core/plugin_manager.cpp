@@ -69,6 +69,26 @@ IPreprocessor* PluginManager::getPreprocessor(const std::string& name) {
     return nullptr;
 }
 
+ICompressionAlgorithm* PluginManager::getAlgorithmById(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& pair : algorithms_) {
+        if (id != 0 && pair.second->getAlgorithmId() == id) {
+            return pair.second.get();
+        }
+    }
+    return nullptr;
+}
+
+IPreprocessor* PluginManager::getPreprocessorById(uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& pair : preprocessors_) {
+        if (id != 0 && pair.second->getPreprocessorId() == id) {
+            return pair.second.get();
+        }
+    }
+    return nullptr;
+}
+
 void PluginManager::loadPluginsFromDirectory(const std::string& directory) {
     namespace fs = std::filesystem;
     if (!fs::exists(directory)) {
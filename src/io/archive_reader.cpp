@@ -0,0 +1,110 @@
+#include "io/archive_reader.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/archive_writer.h"
+
+namespace mrn {
+
+namespace {
+// 提示按页对齐：起点向下取整到页边界，长度相应放大
+void adviseRange(const uint8_t* base, uint64_t offset, uint64_t size, int advice) {
+    static const uint64_t pageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const uint64_t aligned = offset / pageSize * pageSize;
+    // 提示只影响性能，失败时忽略
+    ::madvise(const_cast<uint8_t*>(base) + aligned, static_cast<size_t>(size + (offset - aligned)), advice);
+}
+} // namespace
+
+ArchiveReader::ArchiveReader(const std::string& filename) : filename_(filename) {
+    try {
+        lock_ = std::make_unique<FileLock>(filename, FileLock::Mode::Shared);
+    } catch (const std::exception&) {
+        throw std::runtime_error("Failed to open archive: " + filename);
+    }
+    // 追加全程持有排他锁，取得共享锁后仍有日志说明追加进程已崩溃；
+    // 回滚会改写归档，转为排他锁进行，以免与其他读取者同时回滚。转换锁期间可能有新的追加完成或崩溃，因此重新检查
+    while (ArchiveWriter::needsRecovery(filename)) {
+        lock_->relock(FileLock::Mode::Exclusive);
+        ArchiveWriter::recover(filename);
+        lock_->relock(FileLock::Mode::Shared);
+    }
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open archive: " + filename);
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat archive: " + filename);
+    }
+    size_ = static_cast<uint64_t>(status.st_size);
+    if (size_ < sizeof(MRNArchiveHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Invalid MRN archive");
+    }
+    void* mapping = ::mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后不再需要描述符
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map archive: " + filename);
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+
+    try {
+        directory_ = std::make_unique<DirectoryReader>(data_, size_);
+        const auto& header = directory_->header();
+        if (header.dictionarySize != 0 &&
+            (header.dictionaryOffset > size_ || header.dictionarySize > size_ - header.dictionaryOffset)) {
+            throw std::runtime_error("Shared dictionary out of range");
+        }
+    } catch (...) {
+        ::munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+        throw;
+    }
+}
+
+ArchiveReader::~ArchiveReader() {
+    ::munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+}
+
+const std::vector<ArchiveEntry>& ArchiveReader::entries() {
+    if (!entriesLoaded_) {
+        entries_ = directory_->readAll();
+        entriesLoaded_ = true;
+    }
+    return entries_;
+}
+
+ByteView ArchiveReader::view(uint64_t offset, uint64_t size) const {
+    if (offset > size_ || size > size_ - offset) {
+        throw std::runtime_error("Archive data out of range at offset " + std::to_string(offset));
+    }
+    return ByteView(data_ + offset, static_cast<size_t>(size));
+}
+
+ByteView ArchiveReader::payload(const ArchiveEntry& entry) const {
+    return view(entry.fileOffset, entry.compressedSize);
+}
+
+ByteView ArchiveReader::dictionary() const {
+    const auto& header = directory_->header();
+    return view(header.dictionaryOffset, header.dictionarySize);
+}
+
+void ArchiveReader::advise(Access access) const {
+    adviseRange(data_, 0, size_, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
+
+void ArchiveReader::willNeed(uint64_t offset, uint64_t size) const {
+    if (offset < size_ && size > 0) {
+        adviseRange(data_, offset, std::min(size, size_ - offset), MADV_WILLNEED);
+    }
+}
+
+} // namespace mrn
@@ -1,43 +1,196 @@
 #include "io/archive_writer.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
+#include <exception>
 #include <filesystem>
 #include <stdexcept>
 
+#include "core/plugin_manager.h"
 #include "io/file_io.h"
+#include "utils/crc32c.h"
 #include "utils/logger.h"
 
 namespace mrn {
 
-ArchiveWriter::ArchiveWriter(const std::string& filename, const CompressionPipeline& pipeline)
-    : pipeline_(pipeline),
+namespace {
+#pragma pack(push, 1)
+struct JournalHeader {
+    char magic[4] = {'M', 'R', 'N', 'J'};
+    uint64_t dataEnd = 0;
+    uint64_t tailSize = 0;
+    MRNArchiveHeader header{};
+};
+#pragma pack(pop)
+
+std::string journalPath(const std::string& filename) {
+    return filename + ".journal";
+}
+
+// 日志的创建与删除同样要刷盘所在目录才算落地
+void syncParentDirectory(const std::string& filename) {
+    const auto parent = std::filesystem::path(filename).parent_path();
+    FileIO::sync(parent.empty() ? "." : parent.string());
+}
+
+// 记录 dataEnd 之后的旧目录与旧归档头，刷盘后才允许改动归档
+void writeJournal(const std::string& filename, const MRNArchiveHeader& header, uint64_t dataEnd) {
+    std::ifstream archive(filename, std::ios::binary);
+    const auto fileSize = std::filesystem::file_size(filename);
+    if (!archive || fileSize < dataEnd) {
+        throw std::runtime_error("Failed to read archive: " + filename);
+    }
+    JournalHeader journal;
+    journal.dataEnd = dataEnd;
+    journal.tailSize = fileSize - dataEnd;
+    journal.header = header;
+
+    std::vector<uint8_t> data(sizeof(journal) + journal.tailSize);
+    std::memcpy(data.data(), &journal, sizeof(journal));
+    archive.seekg(static_cast<std::streamoff>(dataEnd), std::ios::beg);
+    archive.read(reinterpret_cast<char*>(data.data() + sizeof(journal)), static_cast<std::streamsize>(journal.tailSize));
+    if (!archive) {
+        throw std::runtime_error("Failed to read archive directory: " + filename);
+    }
+    const uint32_t crc = crc32c(data.data(), data.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        data.push_back(static_cast<uint8_t>(crc >> shift));
+    }
+
+    const auto path = journalPath(filename);
+    FileIO::writeFile(path, data);
+    FileIO::sync(path);
+    syncParentDirectory(filename);
+}
+} // namespace
+
+ArchiveWriter::ArchiveWriter(const std::string& filename, const CompressionPipeline& pipeline, OpenMode mode)
+    : filename_(filename),
+      uncaughtExceptions_(std::uncaught_exceptions()),
+      pipeline_(pipeline),
       threadPool_(std::make_unique<ThreadPool>()) {
+    if (mode == OpenMode::Append) {
+        // 锁一直持有到写入器销毁：其他追加与读取在此期间等待
+        lock_ = std::make_unique<FileLock>(filename, FileLock::Mode::Exclusive);
+        recover(filename);
+        {
+            std::ifstream existing(filename, std::ios::binary);
+            if (!existing) {
+                throw std::runtime_error("Failed to open archive: " + filename);
+            }
+            DirectoryReader reader(existing);
+            header_ = reader.header();
+            fileEntries_ = reader.readAll();
+            currentOffset_ = reader.dataEnd();
+        }
+        writeJournal(filename, header_, currentOffset_);
+        appending_ = true;
+        // 旧版归档追加后整体以当前版本的目录写出
+        header_.version = MRN_ARCHIVE_VERSION;
+        header_.entryHeaderSize = 0;
+        archiveStream_.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+        if (!archiveStream_) {
+            recover(filename);
+            throw std::runtime_error("Failed to open archive: " + filename);
+        }
+        return;
+    }
+
+    // 先不截断地打开（不存在时创建），取得排他锁后才截断：持有共享锁的读取者映射着旧内容，
+    // 截断会让其访问映射时收到 SIGBUS；同名归档上进行中的追加也要等其结束
+    {
+        std::ofstream create(filename, std::ios::binary | std::ios::app);
+        if (!create) {
+            throw std::runtime_error("Failed to open archive: " + filename);
+        }
+    }
+    lock_ = std::make_unique<FileLock>(filename, FileLock::Mode::Exclusive);
     archiveStream_.open(filename, std::ios::binary | std::ios::trunc);
     if (!archiveStream_) {
         throw std::runtime_error("Failed to open archive: " + filename);
     }
+    // 同名归档此前中断的追加日志已不再适用
+    std::filesystem::remove(journalPath(filename));
     // 设置创建时间
     header_.creationTime = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
     writeHeader();
 }
 
+bool ArchiveWriter::needsRecovery(const std::string& filename) {
+    return std::filesystem::exists(journalPath(filename));
+}
+
+void ArchiveWriter::recover(const std::string& filename) {
+    const auto path = journalPath(filename);
+    if (!std::filesystem::exists(path)) {
+        return;
+    }
+    const auto data = FileIO::readFile(path);
+    JournalHeader journal;
+    bool valid = data.size() >= sizeof(journal) + 4;
+    if (valid) {
+        std::memcpy(&journal, data.data(), sizeof(journal));
+        uint32_t stored = 0;
+        for (int i = 0; i < 4; ++i) {
+            stored |= static_cast<uint32_t>(data[data.size() - 4 + i]) << (8 * i);
+        }
+        valid = std::memcmp(journal.magic, "MRNJ", 4) == 0 && journal.tailSize == data.size() - sizeof(journal) - 4 &&
+                crc32c(data.data(), data.size() - 4) == stored;
+    }
+    // 日志不完整说明中断发生在写日志期间，归档尚未改动
+    if (valid) {
+        {
+            std::fstream archive(filename, std::ios::binary | std::ios::in | std::ios::out);
+            if (!archive) {
+                throw std::runtime_error("Failed to open archive for recovery: " + filename);
+            }
+            archive.write(reinterpret_cast<const char*>(&journal.header), sizeof(journal.header));
+            archive.seekp(static_cast<std::streamoff>(journal.dataEnd), std::ios::beg);
+            archive.write(reinterpret_cast<const char*>(data.data() + sizeof(journal)),
+                          static_cast<std::streamsize>(journal.tailSize));
+            if (!archive) {
+                throw std::runtime_error("Failed to restore archive: " + filename);
+            }
+        }
+        std::filesystem::resize_file(filename, journal.dataEnd + journal.tailSize);
+        FileIO::sync(filename);
+        Logger::instance().log(Logger::Level::Warn, "Rolled back an interrupted append: " + filename);
+    }
+    std::filesystem::remove(path);
+    syncParentDirectory(filename);
+}
+
 ArchiveWriter::~ArchiveWriter() {
     if (archiveStream_.is_open()) {
-        finalize();
+        try {
+            if (appending_ && std::uncaught_exceptions() > uncaughtExceptions_) {
+                // 追加因异常中止：已写入的负载不完整，按日志回滚到追加前，而不是提交部分追加
+                archiveStream_.close();
+                recover(filename_);
+                appending_ = false;
+            } else {
+                finalize();
+            }
+        } catch (const std::exception& ex) {
+            // 追加模式下日志仍在，下次打开时回滚
+            Logger::instance().log(Logger::Level::Error, ex.what());
+        }
     }
 }
 
 bool ArchiveWriter::addFile(const std::string& filepath,
                             const std::string& archivePath,
                             const CompressionOptions& options) {
-    auto data = FileIO::readFile(filepath);
+    uint32_t crc = 0;
+    auto data = FileIO::readFile(filepath, crc);
     FileCompressionResult result;
     result.originalPath = filepath;
+    result.checksum = crc;
     result.archivePath = archivePath;
-    result.result.compressedData = data;
     result.result.uncompressedSize = data.size();
+    result.result.compressedData = std::move(data);
     result.result.isCompressed = false;
     return addCompressedFile(result);
 }
@@ -52,30 +205,114 @@ bool ArchiveWriter::addDirectory(const std::string& dirpath,
 bool ArchiveWriter::addCompressedFile(const FileCompressionResult& result) {
     std::lock_guard<std::mutex> lock(writeMutex_);
     
-    FileEntryHeader entry{};
-    std::strncpy(entry.filename, result.archivePath.c_str(), sizeof(entry.filename) - 1);
+    ArchiveEntry entry;
+    entry.name = result.archivePath;
     entry.uncompressedSize = result.result.uncompressedSize;
     entry.compressedSize = result.result.compressedData.size();
     entry.fileOffset = currentOffset_;
-    entry.compressionLevel = 0;
+    entry.compressionLevel = result.compressionLevel;
     entry.permissions = result.filePermissions;
     entry.checksum = result.checksum;
-    if (result.result.isCompressed) {
+    entry.entryType = result.entryType;
+    entry.modifiedTime = result.modifiedTime;
+    entry.flags = MRN_FILE_FLAG_CRC32C;
+    if (result.chunked) {
+        entry.flags |= MRN_FILE_FLAG_CHUNKED;
+    } else if (result.blocked) {
+        entry.flags |= MRN_FILE_FLAG_BLOCKED;
+    } else if (result.result.isCompressed) {
         entry.flags |= MRN_FILE_FLAG_COMPRESSED;
+        entry.flags |= result.result.stages & (MRN_FILE_FLAG_STAGE_MASK | MRN_FILE_FLAG_DICTIONARY);
+        entry.preprocessorCount = static_cast<uint8_t>(result.preprocessorIds.size());
+        std::copy(result.preprocessorIds.begin(), result.preprocessorIds.end(), entry.preprocessorIds);
+        entry.transformedSize = result.transformedSize;
+    }
+    if (entry.flags & (MRN_FILE_FLAG_COMPRESSED | MRN_FILE_FLAG_CHUNKED | MRN_FILE_FLAG_BLOCKED)) {
+        entry.algorithmId = result.algorithmId;
+        entry.algorithmParams = result.algorithmParams;
     }
 
-    archiveStream_.seekp(static_cast<std::streamoff>(currentOffset_));
-    archiveStream_.write(reinterpret_cast<const char*>(result.result.compressedData.data()),
-                         static_cast<std::streamsize>(result.result.compressedData.size()));
+    // 固实成员没有自己的负载，数据在所在块中
+    if (result.entryType == MRN_ENTRY_SOLID_MEMBER) {
+        entry.flags = MRN_FILE_FLAG_CRC32C;
+        entry.compressedSize = 0;
+        entry.fileOffset = result.solidOffset;
+        entry.solidBlock = result.solidBlock;
+    } else if (result.blocked || result.streamed) {
+        // 各块（或流式负载）已紧接着写在 payloadOffset 之后，这里只追加块表（或流的剩余输出），
+        // 条目覆盖全部负载；大小与校验和在此时才确定
+        archiveStream_.seekp(static_cast<std::streamoff>(currentOffset_));
+        archiveStream_.write(reinterpret_cast<const char*>(result.result.compressedData.data()),
+                             static_cast<std::streamsize>(result.result.compressedData.size()));
+        currentOffset_ += result.result.compressedData.size();
+        entry.fileOffset = result.payloadOffset;
+        entry.compressedSize = currentOffset_ - result.payloadOffset;
+        header_.totalCompressedSize += result.result.compressedData.size();
+    } else {
+        archiveStream_.seekp(static_cast<std::streamoff>(currentOffset_));
+        archiveStream_.write(reinterpret_cast<const char*>(result.result.compressedData.data()),
+                             static_cast<std::streamsize>(result.result.compressedData.size()));
+        currentOffset_ += result.result.compressedData.size();
+    }
 
-    currentOffset_ += result.result.compressedData.size();
     fileEntries_.push_back(entry);
     header_.fileCount++;
+    // 块条目的原始大小已由其成员计入
+    if (result.entryType != MRN_ENTRY_SOLID_BLOCK) {
+        header_.totalUncompressedSize += entry.uncompressedSize;
+    }
+    if (!result.blocked && !result.streamed) {
+        header_.totalCompressedSize += entry.compressedSize;
+    }
+    return true;
+}
+
+bool ArchiveWriter::copyEntry(const ArchiveEntry& entry, ByteView payload) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+
+    if (payload.size() != entry.compressedSize) {
+        throw std::runtime_error("Entry payload size mismatch: " + entry.name);
+    }
+    // 负载直接取自源归档的映射，不经过中间缓冲
+    archiveStream_.seekp(static_cast<std::streamoff>(currentOffset_));
+    archiveStream_.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+    ArchiveEntry copied = entry;
+    copied.fileOffset = currentOffset_;
+    currentOffset_ += entry.compressedSize;
+    fileEntries_.push_back(std::move(copied));
+    header_.fileCount++;
     header_.totalUncompressedSize += entry.uncompressedSize;
     header_.totalCompressedSize += entry.compressedSize;
     return true;
 }
 
+uint32_t ArchiveWriter::entryCount() {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    return static_cast<uint32_t>(fileEntries_.size());
+}
+
+uint64_t ArchiveWriter::writeBlob(const std::vector<uint8_t>& data) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+
+    const auto offset = currentOffset_;
+    archiveStream_.seekp(static_cast<std::streamoff>(offset));
+    archiveStream_.write(reinterpret_cast<const char*>(data.data()),
+                         static_cast<std::streamsize>(data.size()));
+
+    // 条目表紧跟在数据区之后，块数据同样计入 totalCompressedSize
+    currentOffset_ += data.size();
+    header_.totalCompressedSize += data.size();
+    return offset;
+}
+
+void ArchiveWriter::setDictionary(const std::vector<uint8_t>& dictionary) {
+    const auto offset = writeBlob(dictionary);
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    header_.dictionaryOffset = offset;
+    header_.dictionarySize = static_cast<uint32_t>(dictionary.size());
+}
+
 void ArchiveWriter::processFileBatch(const std::vector<std::string>& fileBatch,
                                      const CompressionOptions& options) {
     (void)fileBatch;
@@ -87,13 +324,27 @@ bool ArchiveWriter::finalize() {
     archiveStream_.seekp(0);
     writeHeader();
 
-    const auto entriesOffset = currentOffset_;
-    archiveStream_.seekp(static_cast<std::streamoff>(entriesOffset), std::ios::beg);
-    for (const auto& entry : fileEntries_) {
-        archiveStream_.write(reinterpret_cast<const char*>(&entry), sizeof(FileEntryHeader));
-    }
+    // 目录页、页表、名称索引与尾部写在数据区之后，目录页以主算法压缩（更小时）
+    MRNArchiveFooter footer;
+    const auto directory = encodeDirectory(
+        fileEntries_, PluginManager::getInstance().getAlgorithm(pipeline_.mainAlgorithm), currentOffset_, footer);
+    archiveStream_.seekp(static_cast<std::streamoff>(currentOffset_), std::ios::beg);
+    archiveStream_.write(reinterpret_cast<const char*>(directory.data()),
+                         static_cast<std::streamsize>(directory.size()));
+    archiveStream_.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
 
     archiveStream_.close();
+    if (!archiveStream_) {
+        throw std::runtime_error("Failed to write archive: " + filename_);
+    }
+    if (appending_) {
+        // 新目录写完并刷盘后才删除日志；新归档比原来短时截去旧目录的残留
+        std::filesystem::resize_file(filename_, currentOffset_ + directory.size() + sizeof(footer));
+        FileIO::sync(filename_);
+        std::filesystem::remove(journalPath(filename_));
+        syncParentDirectory(filename_);
+        appending_ = false;
+    }
     Logger::instance().log(Logger::Level::Info, "Archive finalized with " + std::to_string(header_.fileCount) + " files.");
     return true;
 }
@@ -2,6 +2,8 @@
 
 #include <filesystem>
 
+#include "io/file_io.h"
+
 namespace fs = std::filesystem;
 
 namespace mrn {
@@ -70,7 +72,7 @@ void DirectoryScanner::scanRecursive(const std::string& rootPath,
         if (!info.isDirectory) {
             info.size = entry.file_size();
         }
-        info.modifiedTime = entry.last_write_time().time_since_epoch().count();
+        info.modifiedTime = FileIO::modifiedTime(info.path);
 
         if (!shouldInclude(info.relativePath, info.size)) {
             continue;
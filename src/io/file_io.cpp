@@ -1,11 +1,281 @@
 #include "io/file_io.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/crc32c.h"
+#include "utils/logger.h"
 
 namespace mrn {
 
+namespace {
+constexpr size_t kChecksumReadSize = 1 << 20;
+// 小于该大小的文件直接读入：建立与解除映射、逐页缺页的固定开销超过一次 read
+constexpr size_t kMinMappedSize = 64 * 1024;
+
+// 受保护的映射区间。映射期间文件被截断时，访问新文件末尾之后的页会收到 SIGBUS；
+// 处理函数把故障页到映射末尾换成匿名零页后返回，读取得以继续，读完后由 MappedFile::verify 报错。
+// 处理函数中只能做异步信号安全的操作，区间表因此是固定大小的原子槽位
+struct GuardedRange {
+    std::atomic<bool> used{false};
+    std::atomic<uintptr_t> begin{0};
+    std::atomic<uintptr_t> end{0};
+    std::atomic<bool> faulted{false};
+};
+constexpr int kMaxGuardedRanges = 256;
+GuardedRange guardedRanges[kMaxGuardedRanges];
+uintptr_t guardPageSize = 4096;
+struct sigaction previousBusAction {};
+
+void onBusError(int signal, siginfo_t* info, void* context) {
+    (void)signal;
+    (void)context;
+    const auto address = reinterpret_cast<uintptr_t>(info->si_addr);
+    for (auto& range : guardedRanges) {
+        const uintptr_t begin = range.begin.load();
+        const uintptr_t end = range.end.load();
+        if (begin != 0 && address >= begin && address < end) {
+            const uintptr_t page = address & ~(guardPageSize - 1);
+            if (::mmap(reinterpret_cast<void*>(page), end - page, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                       -1, 0) != MAP_FAILED) {
+                range.faulted.store(true);
+                return;
+            }
+            break;
+        }
+    }
+    // 不属于受保护的映射：恢复原有处理方式，返回后重新触发故障并照常处理
+    ::sigaction(SIGBUS, &previousBusAction, nullptr);
+}
+
+void installBusGuard() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        guardPageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        struct sigaction action {};
+        action.sa_sigaction = onBusError;
+        action.sa_flags = SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGBUS, &action, &previousBusAction);
+    });
+}
+
+// 登记映射区间，槽位用尽时返回 -1
+int guardRange(const void* data, size_t size) {
+    for (int slot = 0; slot < kMaxGuardedRanges; ++slot) {
+        bool expected = false;
+        if (guardedRanges[slot].used.compare_exchange_strong(expected, true)) {
+            auto& range = guardedRanges[slot];
+            range.faulted.store(false);
+            range.end.store(reinterpret_cast<uintptr_t>(data) + size);
+            range.begin.store(reinterpret_cast<uintptr_t>(data));
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void releaseRange(int slot) {
+    auto& range = guardedRanges[slot];
+    range.begin.store(0);
+    range.end.store(0);
+    range.used.store(false);
+}
+
+// 读入整个文件；遇到文件提前结束时按实际读到的长度截短
+void readAll(int fd, const std::string& path, size_t size, std::vector<uint8_t>& buffer) {
+    buffer.resize(size);
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t got = ::read(fd, buffer.data() + done, size - done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to read file: " + path);
+        }
+        if (got == 0) {
+            break;
+        }
+        done += static_cast<size_t>(got);
+    }
+    buffer.resize(done);
+}
+} // namespace
+
+FileLock::FileLock(const std::string& path, Mode mode) : path_(path) {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    try {
+        acquire(mode);
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+FileLock::FileLock(FileLock&& other) noexcept : path_(std::move(other.path_)), fd_(other.fd_) {
+    other.fd_ = -1;
+}
+
+FileLock::~FileLock() {
+    // 关闭描述符即释放锁
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void FileLock::relock(Mode mode) {
+    acquire(mode);
+}
+
+void FileLock::acquire(Mode mode) {
+    const int operation = mode == Mode::Shared ? LOCK_SH : LOCK_EX;
+    if (::flock(fd_, operation | LOCK_NB) == 0) {
+        return;
+    }
+    if (errno != EWOULDBLOCK) {
+        throw std::runtime_error("Failed to lock file: " + path_);
+    }
+    Logger::instance().log(Logger::Level::Info, "Waiting for another process to release " + path_);
+    while (::flock(fd_, operation) != 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error("Failed to lock file: " + path_);
+        }
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : path_(std::move(other.path_)),
+      data_(other.data_),
+      size_(other.size_),
+      mapped_(other.mapped_),
+      guardSlot_(other.guardSlot_),
+      modifiedTime_(other.modifiedTime_),
+      permissions_(other.permissions_),
+      buffer_(std::move(other.buffer_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mapped_ = false;
+    other.guardSlot_ = -1;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        path_ = std::move(other.path_);
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        guardSlot_ = other.guardSlot_;
+        modifiedTime_ = other.modifiedTime_;
+        permissions_ = other.permissions_;
+        buffer_ = std::move(other.buffer_);
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+        other.guardSlot_ = -1;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    reset();
+}
+
+void MappedFile::reset() {
+    if (guardSlot_ >= 0) {
+        releaseRange(guardSlot_);
+        guardSlot_ = -1;
+    }
+    if (mapped_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    buffer_.clear();
+}
+
+void MappedFile::verify() const {
+    bool truncated = guardSlot_ >= 0 && guardedRanges[guardSlot_].faulted.load();
+    // 截断后没有访问到新末尾之后的页时不会触发故障，另外核对当前大小
+    struct stat status {};
+    if (!truncated && !path_.empty() && ::stat(path_.c_str(), &status) == 0) {
+        truncated = static_cast<uint64_t>(status.st_size) < size_;
+    }
+    if (truncated) {
+        throw std::runtime_error("File was truncated while being read: " + path_);
+    }
+}
+
+MappedFile FileIO::mapFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+
+    MappedFile file;
+    file.path_ = path;
+    file.modifiedTime_ = uint64_t(status.st_mtim.tv_sec) * 1000000000ull + uint64_t(status.st_mtim.tv_nsec);
+    file.permissions_ = static_cast<uint16_t>(status.st_mode & 07777);
+    const auto size = static_cast<size_t>(status.st_size);
+    auto readIntoBuffer = [&] {
+        try {
+            readAll(fd, path, size, file.buffer_);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        file.data_ = file.buffer_.data();
+        file.size_ = file.buffer_.size();
+        return std::move(file);
+    };
+    if (size < kMinMappedSize) {
+        return readIntoBuffer();
+    }
+
+    installBusGuard();
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    const int slot = guardRange(mapping, size);
+    if (slot < 0) {
+        // 同时存在的映射过多，没有空闲槽位保护：改为读入
+        ::munmap(mapping, size);
+        return readIntoBuffer();
+    }
+    ::close(fd);
+    // 提示只影响预读，失败时忽略
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    file.data_ = static_cast<const uint8_t*>(mapping);
+    file.size_ = size;
+    file.mapped_ = true;
+    file.guardSlot_ = slot;
+    return file;
+}
+
 std::vector<uint8_t> FileIO::readFile(const std::string& path) {
     std::ifstream input(path, std::ios::binary);
     if (!input) {
@@ -18,7 +288,31 @@ std::vector<uint8_t> FileIO::readFile(const std::string& path) {
     return buffer;
 }
 
-void FileIO::writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+std::vector<uint8_t> FileIO::readFile(const std::string& path, uint32_t& crc) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    const auto size = std::filesystem::file_size(path);
+    std::vector<uint8_t> buffer(size);
+    crc = 0;
+    size_t done = 0;
+    while (done < buffer.size()) {
+        const size_t step = std::min(kChecksumReadSize, buffer.size() - done);
+        input.read(reinterpret_cast<char*>(buffer.data() + done), static_cast<std::streamsize>(step));
+        const auto got = static_cast<size_t>(input.gcount());
+        crc = crc32c(buffer.data() + done, got, crc);
+        done += got;
+        if (got < step) {
+            break;
+        }
+    }
+    buffer.resize(done);
+    return buffer;
+}
+
+void FileIO::writeFile(const std::string& path, ByteView data) {
     std::ofstream output(path, std::ios::binary);
     if (!output) {
         throw std::runtime_error("Failed to write file: " + path);
@@ -26,4 +320,42 @@ void FileIO::writeFile(const std::string& path, const std::vector<uint8_t>& data
     output.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
 }
 
+uint32_t FileIO::checksumFile(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    std::vector<uint8_t> buffer(kChecksumReadSize);
+    uint32_t crc = 0;
+    while (input) {
+        input.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        crc = crc32c(buffer.data(), static_cast<size_t>(input.gcount()), crc);
+    }
+    if (input.bad()) {
+        throw std::runtime_error("Failed to read file: " + path);
+    }
+    return crc;
+}
+
+uint64_t FileIO::modifiedTime(const std::string& path) {
+    // std::filesystem 的 file_time_type 纪元随实现而定，写入归档的时间改用 stat
+    struct stat status {};
+    if (::stat(path.c_str(), &status) != 0) {
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    return uint64_t(status.st_mtim.tv_sec) * 1000000000ull + uint64_t(status.st_mtim.tv_nsec);
+}
+
+void FileIO::sync(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open for sync: " + path);
+    }
+    const int status = ::fsync(fd);
+    ::close(fd);
+    if (status != 0) {
+        throw std::runtime_error("Failed to sync: " + path);
+    }
+}
+
 } // namespace mrn
@@ -9,7 +9,7 @@
 using namespace mrn;
 
 struct CommandLineOptions {
-    enum Operation { COMPRESS, DECOMPRESS, LIST, TEST };
+    enum Operation { COMPRESS, DECOMPRESS, LIST, TEST, APPEND };
 
     Operation operation = COMPRESS;
     std::vector<std::string> inputPaths;
@@ -21,8 +21,52 @@ struct CommandLineOptions {
     bool verbose = false;
     bool overwrite = false;
     bool preservePaths = true;
+    bool dedup = false;
+    bool trainDictionary = true;
+    std::string dictionaryName;
+    std::string saveDictionaryName;
+    size_t solidBlockSize = 0;
+    size_t splitBlockSize = 8 * 1024 * 1024;
+    size_t maxMemory = 256 * 1024 * 1024;
+    std::string stdinName = "stdin";
+    std::string range; // "偏移:长度"，解压时只输出单个条目的这一段
+    RaceObjective raceObjective = RaceObjective::Off;
+    double raceSizeBound = 1.0;
+    std::string referenceArchive;
+    bool referenceVerifyHash = false;
 };
 
+// 解析大小参数，支持 k/m/g 后缀（如 "4m"）
+size_t parseSize(const std::string& text) {
+    size_t consumed = 0;
+    unsigned long long value = std::stoull(text, &consumed);
+    const std::string suffix = text.substr(consumed);
+    if (suffix == "k" || suffix == "K") {
+        value <<= 10;
+    } else if (suffix == "m" || suffix == "M") {
+        value <<= 20;
+    } else if (suffix == "g" || suffix == "G") {
+        value <<= 30;
+    } else if (!suffix.empty()) {
+        throw std::runtime_error("Invalid size: " + text);
+    }
+    return static_cast<size_t>(value);
+}
+
+// 解析竞速目标："ratio"，或 "speed[:百分比]"（样本压缩后不超过原始大小的该百分比，默认 100）
+void parseRaceObjective(const std::string& text, CommandLineOptions& opts) {
+    if (text == "ratio") {
+        opts.raceObjective = RaceObjective::Ratio;
+    } else if (text.compare(0, 5, "speed") == 0 && (text.size() == 5 || text[5] == ':')) {
+        opts.raceObjective = RaceObjective::Speed;
+        if (text.size() > 5) {
+            opts.raceSizeBound = std::stod(text.substr(6)) / 100.0;
+        }
+    } else {
+        throw std::runtime_error("Invalid race objective: " + text);
+    }
+}
+
 CommandLineOptions parseArguments(int argc, char** argv) {
     CommandLineOptions opts;
     for (int i = 1; i < argc; ++i) {
@@ -31,6 +75,8 @@ CommandLineOptions parseArguments(int argc, char** argv) {
             opts.operation = CommandLineOptions::COMPRESS;
         } else if (arg == "-d" || arg == "--decompress") {
             opts.operation = CommandLineOptions::DECOMPRESS;
+        } else if (arg == "-a" || arg == "--append") {
+            opts.operation = CommandLineOptions::APPEND;
         } else if (arg == "-l" || arg == "--list") {
             opts.operation = CommandLineOptions::LIST;
         } else if (arg == "-t" || arg == "--test") {
@@ -45,12 +91,40 @@ CommandLineOptions parseArguments(int argc, char** argv) {
             opts.algorithm = argv[++i];
         } else if ((arg == "-v" || arg == "--verbose")) {
             opts.verbose = true;
+        } else if (arg == "--dedup") {
+            opts.dedup = true;
+        } else if (arg == "--dict" && i + 1 < argc) {
+            opts.dictionaryName = argv[++i];
+        } else if (arg == "--save-dict" && i + 1 < argc) {
+            opts.saveDictionaryName = argv[++i];
+        } else if (arg == "--no-dict") {
+            opts.trainDictionary = false;
+        } else if (arg == "--solid") {
+            opts.solidBlockSize = 4 * 1024 * 1024;
+        } else if (arg == "--solid-block" && i + 1 < argc) {
+            opts.solidBlockSize = parseSize(argv[++i]);
+        } else if (arg == "--split-size" && i + 1 < argc) {
+            opts.splitBlockSize = parseSize(argv[++i]);
+        } else if (arg == "--max-memory" && i + 1 < argc) {
+            opts.maxMemory = parseSize(argv[++i]);
+        } else if (arg == "--reference" && i + 1 < argc) {
+            opts.referenceArchive = argv[++i];
+        } else if (arg == "--reference-hash") {
+            opts.referenceVerifyHash = true;
+        } else if (arg == "--race" && i + 1 < argc) {
+            parseRaceObjective(argv[++i], opts);
+        } else if (arg == "--range" && i + 1 < argc) {
+            opts.range = argv[++i];
+        } else if (arg == "--stdin-name" && i + 1 < argc) {
+            opts.stdinName = argv[++i];
         } else if (arg == "--overwrite") {
             opts.overwrite = true;
         } else if (arg == "--preserve-paths") {
             opts.preservePaths = true;
         } else if (arg == "--no-preserve-paths") {
             opts.preservePaths = false;
+        } else if (arg == "-") {
+            opts.inputPaths.push_back(arg);
         } else if (arg.front() == '-') {
             throw std::runtime_error("Unknown option: " + arg);
         } else {
@@ -76,6 +150,7 @@ int main(int argc, char** argv) {
             CompressionPreset preset = configMgr.detectBestPreset(options.inputPaths.front());
             pipeline = preset.pipeline;
             compOptions = preset.options;
+            compOptions.autoDetectPreset = true;
         } else if (options.preset != "auto") {
             CompressionPreset preset = configMgr.getPreset(options.preset);
             pipeline = preset.pipeline;
@@ -87,6 +162,16 @@ int main(int argc, char** argv) {
         
         compOptions.verbose = options.verbose;
         compOptions.overwrite = options.overwrite;
+        compOptions.dedup = options.dedup;
+        compOptions.trainDictionary = options.trainDictionary;
+        compOptions.dictionaryName = options.dictionaryName;
+        compOptions.saveDictionaryName = options.saveDictionaryName;
+        compOptions.solidBlockSize = options.solidBlockSize;
+        compOptions.splitBlockSize = options.splitBlockSize;
+        compOptions.raceObjective = options.raceObjective;
+        compOptions.raceSizeBound = options.raceSizeBound;
+        compOptions.referenceArchive = options.referenceArchive;
+        compOptions.referenceVerifyHash = options.referenceVerifyHash;
 
         switch (options.operation) {
             case CommandLineOptions::COMPRESS:
@@ -96,7 +181,18 @@ int main(int argc, char** argv) {
                 if (options.outputPath.empty()) {
                     throw std::runtime_error("No output path specified");
                 }
-                {
+                if (options.inputPaths.front() == "-") {
+                    // 从标准输入流式压缩为单个条目，自动预设按条目名检测
+                    if (options.preset == "auto") {
+                        CompressionPreset preset = configMgr.detectPresetByName(options.stdinName);
+                        pipeline = preset.pipeline;
+                        compOptions = preset.options;
+                        compOptions.verbose = options.verbose;
+                        compOptions.overwrite = options.overwrite;
+                    }
+                    compressor.compressStream(std::cin, options.stdinName, options.outputPath,
+                                              pipeline, compOptions);
+                } else {
                     std::filesystem::path inputPath(options.inputPaths.front());
                     
                     // 如果是auto预设且是单文件，根据文件类型重新检测预设
@@ -106,6 +202,12 @@ int main(int argc, char** argv) {
                         compOptions = preset.options;
                         compOptions.verbose = options.verbose;
                         compOptions.overwrite = options.overwrite;
+                        compOptions.splitBlockSize = options.splitBlockSize;
+                        compOptions.raceObjective = options.raceObjective;
+                        compOptions.raceSizeBound = options.raceSizeBound;
+                        compOptions.referenceArchive = options.referenceArchive;
+                        compOptions.referenceVerifyHash = options.referenceVerifyHash;
+                        compOptions.autoDetectPreset = true;
                     }
                     
                     if (std::filesystem::is_regular_file(inputPath)) {
@@ -125,10 +227,36 @@ int main(int argc, char** argv) {
                 if (options.inputPaths.empty()) {
                     throw std::runtime_error("No archive specified");
                 }
+                if (!options.range.empty()) {
+                    // 按范围读取单个条目，数据写到标准输出
+                    const auto colon = options.range.find(':');
+                    if (options.inputPaths.size() != 2 || colon == std::string::npos) {
+                        throw std::runtime_error("--range requires one entry path and OFFSET:LENGTH");
+                    }
+                    const auto data = compressor.readRange(options.inputPaths[0], options.inputPaths[1],
+                                                           parseSize(options.range.substr(0, colon)),
+                                                           parseSize(options.range.substr(colon + 1)));
+                    std::cout.write(reinterpret_cast<const char*>(data.data()),
+                                    static_cast<std::streamsize>(data.size()));
+                    break;
+                }
                 if (options.outputPath.empty()) {
                     throw std::runtime_error("No output directory specified");
                 }
-                compressor.decompress(options.inputPaths.front(), options.outputPath);
+                compressor.setMemoryBudget(options.maxMemory);
+                // 归档之后的参数为要解压的路径或通配符，省略时解压全部条目
+                compressor.decompress(options.inputPaths.front(), options.outputPath,
+                                      std::vector<std::string>(options.inputPaths.begin() + 1,
+                                                               options.inputPaths.end()));
+                break;
+            case CommandLineOptions::APPEND:
+                // 第一个路径为已有归档，其后为要追加的文件或目录
+                if (options.inputPaths.size() < 2) {
+                    throw std::runtime_error("--append requires an archive and at least one input path");
+                }
+                compressor.append(options.inputPaths.front(),
+                                  std::vector<std::string>(options.inputPaths.begin() + 1, options.inputPaths.end()),
+                                  pipeline, compOptions);
                 break;
             case CommandLineOptions::LIST:
                 if (options.inputPaths.empty()) {
@@ -0,0 +1,89 @@
+#include "utils/byte_histogram.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mrn {
+
+namespace {
+// 32 位子表按段累加后并入 64 位结果，段长保证计数不溢出
+constexpr size_t kSlabSize = size_t(1) << 30;
+// 短输入清零、合并子表的开销超过收益，自动选择时直接逐字节计数
+constexpr size_t kDirectCountLimit = 256;
+
+using SubTables8 = uint32_t[8][256];
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// 一个 64 位字的 8 个字节分别计入 8 张子表
+inline void countWord(SubTables8& tables, uint64_t word) {
+    tables[0][word & 0xFF]++;
+    tables[1][(word >> 8) & 0xFF]++;
+    tables[2][(word >> 16) & 0xFF]++;
+    tables[3][(word >> 24) & 0xFF]++;
+    tables[4][(word >> 32) & 0xFF]++;
+    tables[5][(word >> 40) & 0xFF]++;
+    tables[6][(word >> 48) & 0xFF]++;
+    tables[7][word >> 56]++;
+}
+
+// 每次读取 8 字节，分别计入 8 张子表：相邻的相同字节落在不同计数器上，
+// 连续递增之间没有读写依赖。x86 上曾试过以 SSE2/AVX2 向量加载取数，但计数本身仍是
+// 逐字节的标量递增，不比本实现快，已移除
+void countScalar(const uint8_t* data, size_t size, uint64_t* counts) {
+    alignas(64) SubTables8 tables = {};
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        countWord(tables, load64(data + i));
+    }
+    for (; i < size; ++i) {
+        tables[0][data[i]]++;
+    }
+    for (int s = 0; s < 256; ++s) {
+        uint64_t sum = 0;
+        for (int t = 0; t < 8; ++t) {
+            sum += tables[t][s];
+        }
+        counts[s] += sum;
+    }
+}
+} // namespace
+
+bool histogramKernelSupported(HistogramKernel kernel) {
+    switch (kernel) {
+        case HistogramKernel::Auto:
+        case HistogramKernel::Scalar:
+            return true;
+    }
+    return false;
+}
+
+const char* histogramKernelName(HistogramKernel kernel) {
+    switch (kernel) {
+        case HistogramKernel::Auto:
+            return "auto";
+        case HistogramKernel::Scalar:
+            return "scalar";
+    }
+    return "unknown";
+}
+
+ByteHistogram byteHistogram(const uint8_t* data, size_t size, HistogramKernel kernel) {
+    ByteHistogram counts{};
+    if (kernel == HistogramKernel::Auto && size < kDirectCountLimit) {
+        for (size_t i = 0; i < size; ++i) {
+            counts[data[i]]++;
+        }
+        return counts;
+    }
+    for (size_t offset = 0; offset < size; offset += kSlabSize) {
+        countScalar(data + offset, std::min(kSlabSize, size - offset), counts.data());
+    }
+    return counts;
+}
+
+} // namespace mrn
@@ -0,0 +1,81 @@
+#include "utils/content_chunker.h"
+
+#include <array>
+
+namespace mrn {
+
+namespace {
+// 在高位上均匀铺开 bits 个 1 位；gear 哈希的高位覆盖更长的历史窗口
+constexpr uint64_t spreadMask(unsigned bits) {
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < bits; ++i) {
+        mask |= uint64_t(1) << (63 - i * 3);
+    }
+    return mask;
+}
+
+// 归一化分块：平均长度（2^16）之前掩码多 2 位，之后少 2 位，使块长集中在平均值附近
+constexpr uint64_t kMaskStrict = spreadMask(18);
+constexpr uint64_t kMaskLoose = spreadMask(14);
+
+uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// gear 表由固定种子生成，保证不同版本的分块结果一致
+const std::array<uint64_t, 256>& gearTable() {
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> values{};
+        uint64_t state = 0x4D524E4344433031ull; // "MRNCDC01"
+        for (auto& value : values) {
+            value = splitMix64(state);
+        }
+        return values;
+    }();
+    return table;
+}
+} // namespace
+
+ChunkDigest digestChunk(const uint8_t* data, size_t size) {
+    return {sha256(data, size)};
+}
+
+size_t ContentChunker::nextBoundary(const uint8_t* data, size_t size) {
+    if (size <= kMinChunkSize) {
+        return size;
+    }
+    const auto& gear = gearTable();
+    const size_t limit = size < kMaxChunkSize ? size : kMaxChunkSize;
+    const size_t normal = size < kAverageChunkSize ? size : kAverageChunkSize;
+
+    uint64_t hash = 0;
+    size_t pos = kMinChunkSize;
+    for (; pos < normal; ++pos) {
+        hash = (hash << 1) + gear[data[pos]];
+        if ((hash & kMaskStrict) == 0) {
+            return pos + 1;
+        }
+    }
+    for (; pos < limit; ++pos) {
+        hash = (hash << 1) + gear[data[pos]];
+        if ((hash & kMaskLoose) == 0) {
+            return pos + 1;
+        }
+    }
+    return limit;
+}
+
+std::vector<size_t> ContentChunker::split(const uint8_t* data, size_t size) {
+    std::vector<size_t> ends;
+    size_t pos = 0;
+    while (pos < size) {
+        pos += nextBoundary(data + pos, size - pos);
+        ends.push_back(pos);
+    }
+    return ends;
+}
+
+} // namespace mrn
@@ -0,0 +1,205 @@
+#include "utils/content_probe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "utils/byte_histogram.h"
+
+namespace mrn {
+
+namespace {
+struct MagicSignature {
+    size_t offset;
+    const char* bytes;
+    size_t length;
+    ContentKind kind;
+};
+
+// 常见格式的文件头；压缩过的图片与音视频归入 Compressed
+const MagicSignature kSignatures[] = {
+    {0, "\x1F\x8B", 2, ContentKind::Compressed},                  // gzip
+    {0, "BZh", 3, ContentKind::Compressed},                       // bzip2
+    {0, "\xFD" "7zXZ\x00", 6, ContentKind::Compressed},           // xz
+    {0, "\x28\xB5\x2F\xFD", 4, ContentKind::Compressed},          // zstd
+    {0, "\x04\x22\x4D\x18", 4, ContentKind::Compressed},          // lz4
+    {0, "7z\xBC\xAF\x27\x1C", 6, ContentKind::Compressed},        // 7z
+    {0, "Rar!\x1A\x07", 6, ContentKind::Compressed},              // rar
+    {0, "PK\x03\x04", 4, ContentKind::Compressed},                // zip / jar / docx
+    {0, "MSCF", 4, ContentKind::Compressed},                      // cab
+    {0, "MRN", 3, ContentKind::Compressed},                       // mrn 归档
+    {0, "\xFF\xD8\xFF", 3, ContentKind::Compressed},              // jpeg
+    {0, "\x89PNG\r\n\x1A\n", 8, ContentKind::Compressed},         // png
+    {0, "GIF8", 4, ContentKind::Compressed},                      // gif
+    {8, "WEBP", 4, ContentKind::Compressed},                      // webp（RIFF 容器）
+    {8, "AVI ", 4, ContentKind::Compressed},                      // avi（RIFF 容器）
+    {4, "ftyp", 4, ContentKind::Compressed},                      // mp4 / mov / heic
+    {0, "\x1A\x45\xDF\xA3", 4, ContentKind::Compressed},          // mkv / webm
+    {0, "OggS", 4, ContentKind::Compressed},                      // ogg / opus
+    {0, "fLaC", 4, ContentKind::Compressed},                      // flac
+    {0, "ID3", 3, ContentKind::Compressed},                       // mp3
+    {0, "%PDF", 4, ContentKind::Document},
+    {0, "\x7F" "ELF", 4, ContentKind::Executable},
+    {0, "MZ", 2, ContentKind::Executable},                        // PE
+    {0, "\xFE\xED\xFA\xCE", 4, ContentKind::Executable},          // Mach-O
+    {0, "\xFE\xED\xFA\xCF", 4, ContentKind::Executable},
+    {0, "\xCE\xFA\xED\xFE", 4, ContentKind::Executable},
+    {0, "\xCF\xFA\xED\xFE", 4, ContentKind::Executable},
+    {0, "SQLite format 3", 16, ContentKind::Database},
+};
+
+// MPEG 音频帧头的比特率（kbps），按 [MPEG-1 / MPEG-2、2.5][层 I、II、III][比特率索引]；索引 0（自由格式）与 15（非法）为 0
+const uint16_t kMpegBitrates[2][3][16] = {
+    {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+     {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+     {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0}},
+    {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+     {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+     {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}},
+};
+const uint32_t kMpegSampleRates[3] = {44100, 48000, 32000};
+
+// 解析 data 处的 MPEG 音频帧头，合法时返回帧长，否则返回 0
+size_t mpegFrameLength(const uint8_t* data, size_t size) {
+    if (size < 4 || data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) {
+        return 0;
+    }
+    const int version = (data[1] >> 3) & 3; // 3: MPEG-1，2: MPEG-2，0: MPEG-2.5，1 保留
+    const int layerBits = (data[1] >> 1) & 3; // 3: 层 I，2: 层 II，1: 层 III，0 保留
+    const int bitrateIndex = data[2] >> 4;
+    const int rateIndex = (data[2] >> 2) & 3;
+    if (version == 1 || layerBits == 0 || rateIndex == 3) {
+        return 0;
+    }
+    const int layer = 3 - layerBits; // 0: 层 I，1: 层 II，2: 层 III
+    const bool mpeg1 = version == 3;
+    const uint32_t bitrate = kMpegBitrates[mpeg1 ? 0 : 1][layer][bitrateIndex] * 1000u;
+    if (bitrate == 0) {
+        return 0;
+    }
+    // MPEG-2 采样率减半，MPEG-2.5 再减半
+    const uint32_t sampleRate = kMpegSampleRates[rateIndex] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+    const uint32_t padding = (data[2] >> 1) & 1;
+    if (layer == 0) {
+        return (12 * bitrate / sampleRate + padding) * 4;
+    }
+    const uint32_t factor = layer == 2 && !mpeg1 ? 72 : 144;
+    return factor * bitrate / sampleRate + padding;
+}
+
+// 无 ID3 标签的 mp3 只能靠帧同步字识别。两字节的同步字在文本中也会出现（如 UTF-16 的 BOM FF FE），
+// 因此要求帧头各字段合法，并且按帧长跳过后紧接着是下一个合法帧头
+bool looksLikeMpegAudio(const uint8_t* data, size_t size) {
+    const size_t length = mpegFrameLength(data, size);
+    return length > 0 && length < size && mpegFrameLength(data + length, size - length) > 0;
+}
+
+// UTF-16 的字节序标记
+bool hasUtf16Bom(const uint8_t* data, size_t size) {
+    return size >= 2 && ((data[0] == 0xFF && data[1] == 0xFE) || (data[0] == 0xFE && data[1] == 0xFF));
+}
+
+void readAt(std::ifstream& file, uint64_t offset, size_t size, std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+    out.resize(start + size);
+    file.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    file.read(reinterpret_cast<char*>(out.data() + start), static_cast<std::streamsize>(size));
+    out.resize(start + static_cast<size_t>(file.gcount()));
+    file.clear();
+}
+} // namespace
+
+ContentKind ContentProber::sniffMagic(const uint8_t* data, size_t size) {
+    for (const auto& signature : kSignatures) {
+        if (size >= signature.offset + signature.length &&
+            std::memcmp(data + signature.offset, signature.bytes, signature.length) == 0) {
+            return signature.kind;
+        }
+    }
+    if (!hasUtf16Bom(data, size) && looksLikeMpegAudio(data, size)) {
+        return ContentKind::Compressed;
+    }
+    return ContentKind::Unknown;
+}
+
+double ContentProber::entropy(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    double bits = 0;
+    for (uint64_t count : byteHistogram(data, size)) {
+        if (count > 0) {
+            const double p = static_cast<double>(count) / static_cast<double>(size);
+            bits -= p * std::log2(p);
+        }
+    }
+    return bits;
+}
+
+bool ContentProber::looksLikeText(const uint8_t* data, size_t size) {
+    // 带 BOM 的 UTF-16 文本按 16 位码元检查：ASCII 字符的高字节为 0，不能按 NUL 判定为二进制
+    if (hasUtf16Bom(data, size)) {
+        const bool bigEndian = data[0] == 0xFE;
+        size_t units = 0;
+        size_t control = 0;
+        for (size_t i = 2; i + 1 < size; i += 2, ++units) {
+            const uint16_t unit = bigEndian ? uint16_t(data[i] << 8 | data[i + 1]) : uint16_t(data[i + 1] << 8 | data[i]);
+            if (unit == 0) {
+                return false;
+            }
+            if (unit < 0x20 && unit != '\t' && unit != '\n' && unit != '\r' && unit != '\f' && unit != 0x1B) {
+                ++control;
+            }
+        }
+        return units > 0 && control * 100 <= units;
+    }
+    size_t control = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const uint8_t byte = data[i];
+        if (byte == 0) {
+            return false;
+        }
+        if (byte < 0x20 && byte != '\t' && byte != '\n' && byte != '\r' && byte != '\f' && byte != 0x1B) {
+            ++control;
+        }
+    }
+    return size > 0 && control * 100 <= size;
+}
+
+ContentProbe ContentProber::probe(const std::vector<uint8_t>& head, const std::vector<uint8_t>& sample) {
+    ContentProbe result;
+    result.kind = sniffMagic(head.data(), head.size());
+    result.entropy = entropy(sample.data(), sample.size());
+    result.text = looksLikeText(sample.data(), sample.size());
+    result.sampleSize = sample.size();
+    return result;
+}
+
+ContentProbe ContentProber::probeFile(const std::string& path) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return {};
+    }
+    const uint64_t size = std::filesystem::file_size(path, error);
+    std::ifstream file(path, std::ios::binary);
+    if (error || !file) {
+        return {};
+    }
+
+    // 小文件整体作为样本；否则取头、中、尾三段，避免只看到文件头部的元数据
+    std::vector<uint8_t> sample;
+    if (size <= 3 * kSampleSize) {
+        readAt(file, 0, static_cast<size_t>(size), sample);
+    } else {
+        readAt(file, 0, kSampleSize, sample);
+        readAt(file, size / 2 - kSampleSize / 2, kSampleSize, sample);
+        readAt(file, size - kSampleSize, kSampleSize, sample);
+    }
+    const std::vector<uint8_t> head(sample.begin(), sample.begin() + static_cast<std::ptrdiff_t>(
+                                                        std::min<size_t>(sample.size(), kSampleSize)));
+    return probe(head, sample);
+}
+
+} // namespace mrn
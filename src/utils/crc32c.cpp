@@ -0,0 +1,149 @@
+#include "utils/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MRN_CRC32C_X86 1
+#include <nmmintrin.h>
+#endif
+
+namespace mrn {
+
+namespace {
+constexpr uint32_t kPolynomial = 0x82F63B78; // 0x1EDC6F41 的位反转形式
+
+using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
+
+const SliceTables& sliceTables() {
+    static const SliceTables tables = [] {
+        SliceTables t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1)));
+            }
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t k = 1; k < 8; ++k) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+        return t;
+    }();
+    return tables;
+}
+
+// 每次处理 8 字节：8 张表分别查出各字节对 CRC 的贡献后异或
+uint32_t updateSliced(uint32_t crc, const uint8_t* data, size_t size) {
+    const auto& t = sliceTables();
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^
+              t[4][(word >> 24) & 0xFF] ^ t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^
+              t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef MRN_CRC32C_X86
+__attribute__((target("sse4.2")))
+uint32_t updateHardware(uint32_t crc, const uint8_t* data, size_t size) {
+    uint64_t value = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        value = _mm_crc32_u64(value, word);
+        data += 8;
+        size -= 8;
+    }
+    auto result = static_cast<uint32_t>(value);
+    while (size-- > 0) {
+        result = _mm_crc32_u8(result, *data++);
+    }
+    return result;
+}
+#endif
+
+using UpdateFunction = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+UpdateFunction updateFunction() {
+    static const UpdateFunction update = [] {
+#ifdef MRN_CRC32C_X86
+        if (__builtin_cpu_supports("sse4.2")) {
+            return updateHardware;
+        }
+#endif
+        return updateSliced;
+    }();
+    return update;
+}
+
+// GF(2) 上的 32×32 矩阵乘法，用于把 CRC 向后推进若干个零字节（与 zlib crc32_combine 相同的做法）
+uint32_t matrixTimes(const uint32_t* matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    for (; vector != 0; vector >>= 1, ++matrix) {
+        if (vector & 1) {
+            sum ^= *matrix;
+        }
+    }
+    return sum;
+}
+
+void matrixSquare(uint32_t* square, const uint32_t* matrix) {
+    for (int n = 0; n < 32; ++n) {
+        square[n] = matrixTimes(matrix, matrix[n]);
+    }
+}
+} // namespace
+
+uint32_t crc32c(const uint8_t* data, size_t size, uint32_t crc) {
+    return ~updateFunction()(~crc, data, size);
+}
+
+uint32_t crc32cCombine(uint32_t crc1, uint32_t crc2, uint64_t length2) {
+    if (length2 == 0) {
+        return crc1;
+    }
+    uint32_t even[32]; // 推进 2^k 个零位的算子
+    uint32_t odd[32];
+
+    // 推进一个零位的算子
+    odd[0] = kPolynomial;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; ++n) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    matrixSquare(even, odd); // 两个零位
+    matrixSquare(odd, even); // 四个零位
+
+    // 每轮平方一次，按 length2 的二进制位把 crc1 推进 length2 个零字节
+    do {
+        matrixSquare(even, odd);
+        if (length2 & 1) {
+            crc1 = matrixTimes(even, crc1);
+        }
+        length2 >>= 1;
+        if (length2 == 0) {
+            break;
+        }
+        matrixSquare(odd, even);
+        if (length2 & 1) {
+            crc1 = matrixTimes(odd, crc1);
+        }
+        length2 >>= 1;
+    } while (length2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+} // namespace mrn